@@ -0,0 +1,132 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "planejador.h"
+#include "gerador-mapas.h"
+
+using namespace std;
+
+/// *******************************************************************************
+/// Benchmark do calculo de caminhos (Planejador::calculaCaminho).
+/// Uso: planejador-benchmark [--pontos N] [--consultas N] [--semente N]
+///                           [--mapa arq_pontos arq_rotas]
+/// Sem --mapa, gera um mapa aleatorio com N pontos (gerador-mapas.h).
+/// As consultas sao pares <origem,destino> sorteados com a semente, de modo
+/// que execucoes com os mesmos parametros sao comparaveis entre compilacoes
+/// (Release, LTO, PGO): a soma dos comprimentos deve ser a mesma.
+/// *******************************************************************************
+
+namespace
+{
+/// Tempo decorrido desde t (em ms)
+double milissegundos(chrono::steady_clock::time_point t)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - t).count();
+}
+
+/// Leh as ids dos pontos de um arquivo de pontos (1o campo de cada linha)
+bool leIds(const string& arq_pontos, vector<IDPonto>& ids)
+{
+  ifstream arq(arq_pontos);
+  string linha;
+  if (!getline(arq, linha)) return false;  // Cabecalho
+  while (getline(arq, linha))
+  {
+    IDPonto Id;
+    Id.set(linha.substr(0, linha.find(';')));
+    if (Id.valid()) ids.push_back(Id);
+  }
+  return !ids.empty();
+}
+}
+
+int main(int argc, char** argv)
+{
+  size_t num_pontos(100000), num_consultas(500);
+  unsigned semente(1);
+  string arq_pontos, arq_rotas;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--pontos") == 0 && i+1 < argc) num_pontos = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--consultas") == 0 && i+1 < argc) num_consultas = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--semente") == 0 && i+1 < argc) semente = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--mapa") == 0 && i+2 < argc)
+    {
+      arq_pontos = argv[++i];
+      arq_rotas = argv[++i];
+    }
+    else
+    {
+      cerr << "Uso: " << argv[0] << " [--pontos N] [--consultas N] [--semente N]"
+           << " [--mapa arq_pontos arq_rotas]\n";
+      return 2;
+    }
+  }
+
+  // O mapa
+  vector<IDPonto> ids;
+  if (arq_pontos.empty())
+  {
+    arq_pontos = "benchmark-pontos.txt";
+    arq_rotas = "benchmark-rotas.txt";
+    MapaGerado M = geraMapa(num_pontos, 3, semente);
+    if (!gravaMapa(M, arq_pontos, arq_rotas))
+    {
+      cerr << "Erro na gravacao do mapa gerado\n";
+      return 1;
+    }
+    for (const string& Id : M.id_pt)
+    {
+      ids.emplace_back();
+      ids.back().set(string(Id));
+    }
+  }
+  else if (!leIds(arq_pontos, ids))
+  {
+    cerr << "Erro na leitura das ids de " << arq_pontos << endl;
+    return 1;
+  }
+
+  Planejador G;
+  auto t = chrono::steady_clock::now();
+  if (!G.ler(arq_pontos, arq_rotas))
+  {
+    cerr << "Erro na leitura dos arquivos do mapa\n";
+    return 1;
+  }
+  cout << "Mapa: " << ids.size() << " pontos\tLeitura: " << milissegundos(t) << "ms\n";
+
+  // Sorteia as consultas antes de medir
+  mt19937 gerador(semente);
+  uniform_int_distribution<size_t> sorteio(0, ids.size()-1);
+  vector< pair<size_t,size_t> > consultas(num_consultas);
+  for (auto& c : consultas) c = {sorteio(gerador), sorteio(gerador)};
+
+  Caminho C;
+  int NA, NF;
+  double soma(0.0);
+  size_t soma_NF(0), sem_caminho(0);
+  t = chrono::steady_clock::now();
+  for (const auto& c : consultas)
+  {
+    double compr = G.calculaCaminho(ids[c.first], ids[c.second], C, NA, NF);
+    if (compr < 0.0) ++sem_caminho;
+    else soma += compr;
+    soma_NF += max(NF, 0);
+  }
+  double dt = milissegundos(t);
+
+  cout << "calculaCaminho: " << num_consultas << " consultas em " << dt << "ms\t"
+       << (dt > 0.0 ? 1000.0*num_consultas/dt : 0.0) << " consultas/s\n"
+       << "Nohs fechados por consulta: " << (num_consultas ? soma_NF/num_consultas : 0)
+       << "\tSem caminho: " << sem_caminho << endl;
+  cout.precision(12);
+  cout << "Soma dos comprimentos: " << soma << "km\n";
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <fstream>
+#include <string>
+#include <filesystem>
+
+#if defined(_WIN32)
+#include <cstdlib>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "planejador-arquivo.h"
+
+using namespace std;
+
+/// Mapeia em memoria tam bytes do arquivo (nome ou descritor fd), a partir de inicio.
+/// Retorna a regiao mapeada (nullptr em caso de erro) e, em dados, o endereco
+/// correspondente a inicio. Sem mmap, leh o trecho do arquivo para a memoria.
+void* mapeia(const string& nome, int fd, uint64_t inicio, uint64_t tam, const char*& dados)
+{
+#if defined(_WIN32)
+  (void)fd;
+  char* buf = static_cast<char*>(::operator new(tam));
+  ifstream arq(nome, ios::binary);
+  arq.seekg(inicio);
+  arq.read(buf, tam);
+  if (arq.fail())
+  {
+    ::operator delete(buf);
+    return nullptr;
+  }
+  dados = buf;
+  return buf;
+#else
+  (void)nome;
+  // O mapeamento deve comecar no inicio de uma pagina
+  static const uint64_t PAGINA = sysconf(_SC_PAGESIZE);
+  uint64_t desloc = inicio % PAGINA;
+  void* p = mmap(nullptr, tam + desloc, PROT_READ, MAP_SHARED, fd, inicio - desloc);
+  if (p == MAP_FAILED) return nullptr;
+  dados = static_cast<const char*>(p) + desloc;
+  return p;
+#endif
+}
+
+/// Desfaz o mapeamento de uma regiao retornada por mapeia
+void desmapeia(void* regiao, const char* dados, uint64_t tam)
+{
+#if defined(_WIN32)
+  (void)dados;
+  (void)tam;
+  ::operator delete(regiao);
+#else
+  munmap(regiao, tam + (dados - static_cast<const char*>(regiao)));
+#endif
+}
+
+/// Avisa o sistema que uma regiao mapeada sera lida em breve
+void antecipaLeitura(void* regiao, const char* dados, uint64_t tam)
+{
+#if !defined(_WIN32) && defined(MADV_WILLNEED)
+  madvise(regiao, tam + (dados - static_cast<const char*>(regiao)), MADV_WILLNEED);
+#else
+  (void)regiao;
+  (void)dados;
+  (void)tam;
+#endif
+}
+
+/* *************************
+   * CLASSE ARQUIVOMAPEADO *
+   ************************* */
+
+/// Mapeia o arquivo inteiro e avisa o sistema que sera lido em breve.
+/// Retorna false se nao conseguir.
+bool ArquivoMapeado::abrir(const string& nome)
+{
+  fechar();
+  error_code erro;
+  uint64_t tam_arq = filesystem::file_size(nome, erro);
+  if (erro) return false;
+  // mmap nao mapeia regioes vazias
+  if (tam_arq == 0) return true;
+#if !defined(_WIN32)
+  fd = open(nome.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+#endif
+  regiao = mapeia(nome, fd, 0, tam_arq, inicio);
+  if (regiao == nullptr)
+  {
+    fechar();
+    return false;
+  }
+  tam = tam_arq;
+  antecipaLeitura(regiao, inicio, tam);
+  return true;
+}
+
+/// Desfaz o mapeamento e fecha o arquivo
+void ArquivoMapeado::fechar()
+{
+  if (regiao != nullptr) desmapeia(regiao, inicio, tam);
+#if !defined(_WIN32)
+  if (fd >= 0) close(fd);
+#endif
+  fd = -1;
+  regiao = nullptr;
+  inicio = nullptr;
+  tam = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef _PLANEJADOR_ARQUIVO_H_
+#define _PLANEJADOR_ARQUIVO_H_
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+/// *******************************************************************************
+/// Arquivos mapeados em memoria, somente para leitura: usados na leitura do mapa
+/// (Planejador::lerParalelo) e nos ladrilhos (MapaLadrilhado).
+/// Sem mmap (Windows), os trechos sao lidos para a memoria em modo binario.
+/// *******************************************************************************
+
+/// Mapeia em memoria tam bytes do arquivo (nome ou descritor fd), a partir de inicio.
+/// Retorna a regiao mapeada (nullptr em caso de erro) e, em dados, o endereco
+/// correspondente a inicio. Sem mmap, leh o trecho do arquivo para a memoria.
+void* mapeia(const std::string& nome, int fd, uint64_t inicio, uint64_t tam,
+             const char*& dados);
+
+/// Desfaz o mapeamento de uma regiao retornada por mapeia
+void desmapeia(void* regiao, const char* dados, uint64_t tam);
+
+/// Avisa o sistema que uma regiao mapeada sera lida em breve
+void antecipaLeitura(void* regiao, const char* dados, uint64_t tam);
+
+/* *************************
+   * CLASSE ARQUIVOMAPEADO *
+   ************************* */
+
+/// Conteudo de um arquivo inteiro mapeado em memoria
+class ArquivoMapeado
+{
+private:
+  int fd;
+  void* regiao;         // Regiao mapeada
+  const char* inicio;   // Conteudo do arquivo
+  size_t tam;
+
+public:
+  ArquivoMapeado(): fd(-1), regiao(nullptr), inicio(nullptr), tam(0) {}
+  ~ArquivoMapeado()
+  {
+    fechar();
+  }
+  ArquivoMapeado(const ArquivoMapeado&) = delete;
+  ArquivoMapeado& operator=(const ArquivoMapeado&) = delete;
+
+  /// Mapeia o arquivo inteiro. Retorna false se nao conseguir.
+  bool abrir(const std::string& nome);
+  /// Desfaz o mapeamento e fecha o arquivo
+  void fechar();
+
+  std::string_view conteudo() const
+  {
+    return std::string_view(inicio, tam);
+  }
+};
+
+#endif // _PLANEJADOR_ARQUIVO_H_
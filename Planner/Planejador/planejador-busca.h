@@ -0,0 +1,167 @@
+#ifndef _PLANEJADOR_BUSCA_H_
+#define _PLANEJADOR_BUSCA_H_
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+#include "planejador.h"
+
+/// Executa tarefa(0), ..., tarefa(num_tarefas-1) distribuidas entre num_threads threads
+/// (0 == numero de nucleos disponiveis)
+void executaEmParalelo(size_t num_tarefas, unsigned num_threads,
+                       const std::function<void(size_t)>& tarefa);
+
+/// *******************************************************************************
+/// Algoritmo A* comum aos mapas em memoria (Planejador) e em ladrilhos (MapaLadrilhado)
+/// *******************************************************************************
+
+/// Calcula o caminho mais curto no grafo G entre origem e destino, usando o algoritmo A*.
+/// O Grafo deve fornecer:
+///   Grafo::No     : identificador compacto de um ponto (copiavel, com std::hash e ==)
+///   Grafo::Rota   : identificador compacto de uma rota (copiavel)
+///   void coordenadas(No, double& lat, double& lon)
+///   template<class F> void paraCadaRota(No, F f): chama f(Rota, No sucessor,
+///       double comprimento, double lat_sucessor, double lon_sucessor) para cada
+///       rota incidente no ponto, na ordem do arquivo de rotas
+///   IDPonto idPonto(No) e IDRota idRota(Rota): conversao para os ids do mapa
+/// Os nos em aberto sao escolhidos pelo menor custo total f() e, em caso de empate,
+/// pelo que entrou (ou foi atualizado) em Aberto ha mais tempo.
+/// Retorno e parametros como em Planejador::calculaCaminho.
+template<class Grafo>
+double buscaAEstrela(Grafo& G, typename Grafo::No orig, typename Grafo::No dest,
+                     Caminho& C, int& NA, int& NF)
+{
+  using No = typename Grafo::No;
+  using Rota = typename Grafo::Rota;
+
+  /// Noh: os elementos dos conjuntos de busca do algoritmo A*
+  struct Noh
+  {
+    No pt;          // Ponto
+    No ant;         // Ponto anterior no caminho (pt na origem)
+    Rota rt;        // Rota do ponto anterior ateh o ponto
+    bool origem;    // Se eh o noh inicial (sem rota anterior)
+    bool fechado;   // Se jah estah em Fechado
+    double g;       // Custo acumulado do caminho
+    double h;       // Heurística (estimativa do custo restante)
+    uint64_t ordem; // Ordem de entrada (ou de atualizacao) em Aberto
+
+    // Função custo total
+    double f() const
+    {
+      return g + h;
+    }
+  };
+
+  // Entrada da fila de prioridade: <f, ordem, indice do noh>.
+  // Entradas de nos atualizados ou jah fechados sao descartadas ao sair da fila.
+  struct Entrada
+  {
+    double f;
+    uint64_t ordem;
+    size_t i;
+    // Inverte a comparacao para que o menor <f,ordem> fique no topo do heap
+    bool operator<(const Entrada& E) const
+    {
+      return (f != E.f ? f > E.f : ordem > E.ordem);
+    }
+  };
+
+  C.clear();
+
+  double lat_dest, lon_dest;
+  G.coordenadas(dest, lat_dest, lon_dest);
+  // Heuristica: distancia em linha reta ateh o destino
+  auto heuristica = [&](const No& n, double lat, double lon) {
+    return (n == dest ? 0.0 : haversine(lat, lon, lat_dest, lon_dest));
+  };
+
+  std::vector<Noh> nohs;
+  std::unordered_map<No, size_t> indice;
+  std::vector<Entrada> Aberto;
+  size_t num_abertos(0), num_fechados(0);
+  uint64_t ordem(0);
+
+  // Noh inicial
+  {
+    double lat, lon;
+    G.coordenadas(orig, lat, lon);
+    nohs.push_back({orig, orig, Rota(), true, false, 0.0, heuristica(orig, lat, lon), ordem++});
+    indice.emplace(orig, 0);
+    Aberto.push_back({nohs[0].f(), nohs[0].ordem, 0});
+    num_abertos = 1;
+  }
+
+  // Laço principal
+  while (!Aberto.empty())
+  {
+    // Encontra o nó com menor custo total f()
+    std::pop_heap(Aberto.begin(), Aberto.end());
+    Entrada E = Aberto.back();
+    Aberto.pop_back();
+    if (nohs[E.i].fechado || nohs[E.i].ordem != E.ordem) continue;
+
+    // Move o nó atual para Fechado
+    nohs[E.i].fechado = true;
+    --num_abertos;
+    ++num_fechados;
+    const No atual = nohs[E.i].pt;
+    const double g_atual = nohs[E.i].g;
+
+    // Verifica se o destino foi alcançado
+    if (atual == dest)
+    {
+      // Reconstrói o caminho subindo pelos antecessores
+      for (size_t i = E.i; ; i = indice.at(nohs[i].ant))
+      {
+        C.push_front({nohs[i].origem ? IDRota() : G.idRota(nohs[i].rt), G.idPonto(nohs[i].pt)});
+        if (nohs[i].origem) break;
+      }
+      NA = num_abertos;
+      NF = num_fechados;
+      return g_atual;
+    }
+
+    // Gera sucessores
+    G.paraCadaRota(atual, [&](const Rota& rt, const No& suc, double comprimento,
+                              double lat, double lon) {
+      auto it = indice.find(suc);
+      if (it != indice.end() && nohs[it->second].fechado) return; // Ignora nós já processados
+
+      double custo_g = g_atual + comprimento;
+      double custo_h = (it != indice.end() ? nohs[it->second].h : heuristica(suc, lat, lon));
+
+      size_t i;
+      if (it == indice.end())
+      {
+        i = nohs.size();
+        nohs.push_back({suc, atual, rt, false, false, custo_g, custo_h, ordem++});
+        indice.emplace(suc, i);
+        ++num_abertos;
+      }
+      else if (custo_g + custo_h < nohs[it->second].f())
+      {
+        // Caminho melhor para um nó em Aberto: volta ao final da ordem
+        i = it->second;
+        nohs[i].ant = atual;
+        nohs[i].rt = rt;
+        nohs[i].g = custo_g;
+        nohs[i].ordem = ordem++;
+      }
+      else return;
+
+      Aberto.push_back({nohs[i].f(), nohs[i].ordem, i});
+      std::push_heap(Aberto.begin(), Aberto.end());
+    });
+  }
+
+  // Não há solução
+  NA = num_abertos;
+  NF = num_fechados;
+  return -1.0;
+}
+
+#endif // _PLANEJADOR_BUSCA_H_
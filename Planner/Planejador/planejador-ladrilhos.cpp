@@ -0,0 +1,711 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "planejador.h"
+#include "planejador-ladrilhos.h"
+#include "planejador-busca.h"
+#include "planejador-arquivo.h"
+
+using namespace std;
+
+/// *******************************************************************************
+/// Formato dos arquivos de ladrilhos
+/// *******************************************************************************
+///
+/// <dir>/ladrilhos.idx:
+///   CabecalhoIndice
+///   EntradaLadrilho[num_ladrilhos]
+///   EntradaDiretorio[tam_diretorio]  (tabela de espalhamento id -> ponto)
+///
+/// <dir>/ladrilhos.dat: os ladrilhos, um apos o outro, cada um com
+///   CabecalhoLadrilho
+///   PontoLadrilho[num_pontos]
+///   ArestaLadrilho[num_arestas]
+///   uint32_t inicio_arestas[num_pontos+1]  (arestas de cada ponto)
+///   char textos[]                          (ids e nomes terminados por '\0')
+///
+/// Um ponto eh identificado por <ladrilho,indice no ladrilho> (tipo No).
+/// As arestas guardam as coordenadas do ponto vizinho, para que a heuristica
+/// possa ser calculada sem carregar o ladrilho do vizinho.
+
+namespace
+{
+const char MAGICA[8] = {'P','L','A','N','L','A','D','1'};
+const uint64_t VAZIO = ~uint64_t(0);
+
+struct CabecalhoIndice
+{
+  char magica[8];
+  double tam_graus;
+  uint64_t num_ladrilhos;
+  uint64_t num_pontos;
+  uint64_t tam_diretorio;
+};
+
+struct EntradaLadrilho
+{
+  int32_t linha, coluna;
+  uint64_t inicio, tamanho;
+};
+
+struct EntradaDiretorio
+{
+  uint64_t espalhamento;
+  uint64_t no;            // VAZIO se a posicao estah livre
+};
+
+struct CabecalhoLadrilho
+{
+  uint32_t num_pontos;
+  uint32_t num_arestas;
+};
+
+struct PontoLadrilho
+{
+  double latitude, longitude;
+  uint32_t id, nome;      // Posicoes em textos
+};
+
+struct ArestaLadrilho
+{
+  double comprimento;
+  double latitude, longitude;  // Coordenadas do vizinho
+  uint64_t vizinho;            // No do vizinho
+  uint32_t id_rota;            // Posicao em textos
+  uint32_t reservado;
+};
+
+/// Ponteiros para as partes de um ladrilho carregado
+struct VisaoLadrilho
+{
+  const CabecalhoLadrilho* cab;
+  const PontoLadrilho* pontos;
+  const ArestaLadrilho* arestas;
+  const uint32_t* inicio_arestas;
+  const char* textos;
+
+  explicit VisaoLadrilho(const char* dados)
+  {
+    cab = reinterpret_cast<const CabecalhoLadrilho*>(dados);
+    pontos = reinterpret_cast<const PontoLadrilho*>(cab+1);
+    arestas = reinterpret_cast<const ArestaLadrilho*>(pontos + cab->num_pontos);
+    inicio_arestas = reinterpret_cast<const uint32_t*>(arestas + cab->num_arestas);
+    textos = reinterpret_cast<const char*>(inicio_arestas + cab->num_pontos + 1);
+  }
+};
+
+/// Testa se as partes de um ladrilho com tam bytes cabem nele, antes que
+/// VisaoLadrilho calcule os ponteiros a partir dos contadores do cabecalho,
+/// e se os indices e posicoes de textos guardados nele estao dentro das partes
+bool ladrilhoValido(const char* dados, uint64_t tam)
+{
+  if (tam < sizeof(CabecalhoLadrilho)) return false;
+  const CabecalhoLadrilho* cab = reinterpret_cast<const CabecalhoLadrilho*>(dados);
+  uint64_t tam_partes = sizeof(CabecalhoLadrilho)
+                        + uint64_t(cab->num_pontos)*sizeof(PontoLadrilho)
+                        + uint64_t(cab->num_arestas)*sizeof(ArestaLadrilho)
+                        + (uint64_t(cab->num_pontos)+1)*sizeof(uint32_t);
+  if (tam_partes > tam) return false;
+  // Os textos terminam com '\0': qualquer posicao dentro deles eh um texto valido
+  uint64_t tam_textos = tam - tam_partes;
+  if (tam_textos > 0 && dados[tam-1] != '\0') return false;
+
+  VisaoLadrilho V(dados);
+  // As arestas de cada ponto comecam onde terminam as do anterior,
+  // e as do ultimo ponto terminam no fim das arestas
+  if (V.inicio_arestas[0] != 0) return false;
+  for (uint32_t i = 0; i < cab->num_pontos; ++i)
+  {
+    if (V.inicio_arestas[i+1] < V.inicio_arestas[i]) return false;
+    if (V.pontos[i].id >= tam_textos || V.pontos[i].nome >= tam_textos) return false;
+  }
+  if (V.inicio_arestas[cab->num_pontos] != cab->num_arestas) return false;
+  for (uint32_t k = 0; k < cab->num_arestas; ++k)
+  {
+    if (V.arestas[k].id_rota >= tam_textos) return false;
+  }
+  return true;
+}
+
+/// Composicao e decomposicao de um No: <ladrilho,indice>
+inline uint64_t no(uint32_t t, uint32_t i)
+{
+  return (uint64_t(t) << 32) | i;
+}
+inline uint32_t ladrilhoDe(uint64_t n)
+{
+  return uint32_t(n >> 32);
+}
+inline uint32_t indiceDe(uint64_t n)
+{
+  return uint32_t(n);
+}
+
+/// Chave da grade de ladrilhos
+inline uint64_t chave(int32_t linha, int32_t coluna)
+{
+  return (uint64_t(uint32_t(linha)) << 32) | uint32_t(coluna);
+}
+
+/// Posicao na grade de ladrilhos de uma coordenada
+inline int32_t linhaDe(double lat, double tam_graus)
+{
+  return int32_t(floor((lat+90.0)/tam_graus));
+}
+inline int32_t colunaDe(double lon, double tam_graus)
+{
+  return int32_t(floor((lon+180.0)/tam_graus));
+}
+
+/// Espalhamento das ids no diretorio (FNV-1a): o mesmo em qualquer plataforma
+uint64_t espalhamento(string_view S)
+{
+  uint64_t h = 14695981039346656037ull;
+  for (char c : S)
+  {
+    h ^= static_cast<unsigned char>(c);
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+/// Inclui um texto (terminado por '\0') no buffer e retorna sua posicao
+uint32_t incluiTexto(string& textos, string_view S)
+{
+  uint32_t pos = textos.size();
+  textos.append(S.data(), S.size());
+  textos.push_back('\0');
+  return pos;
+}
+
+/// Inclui os bytes de um vetor de estruturas no final de um buffer
+template<class T>
+void grava(string& buf, const vector<T>& V)
+{
+  buf.append(reinterpret_cast<const char*>(V.data()), V.size()*sizeof(T));
+}
+}
+
+/* *************************
+   * CLASSE PLANEJADOR     *
+   ************************* */
+
+/// Grava o mapa no diretorio dir dividido em ladrilhos de tam_graus x tam_graus graus.
+/// Retorna false se o mapa estiver vazio ou nao conseguir gravar os arquivos.
+bool Planejador::salvarLadrilhos(const std::string& dir, double tam_graus) const
+{
+  try
+  {
+    if (empty()) throw 1;
+    if (!(tam_graus > 0.0)) throw 2;
+
+    error_code erro;
+    filesystem::create_directories(dir, erro);
+    if (erro) throw 3;
+
+    // Distribui os pontos nos ladrilhos, ordenados pela posicao na grade.
+    // Dentro de um ladrilho, os pontos ficam na ordem do arquivo de pontos.
+    map< pair<int32_t,int32_t>, vector<const Ponto*> > por_ladrilho;
+    for (const Ponto& P : pontos)
+    {
+      por_ladrilho[{linhaDe(P.latitude, tam_graus),
+                    colunaDe(P.longitude, tam_graus)}].push_back(&P);
+    }
+
+    // No de cada ponto
+    unordered_map<IDPonto, uint64_t> nos;
+    nos.reserve(pontos.size());
+    {
+      uint32_t t = 0;
+      for (const auto& L : por_ladrilho)
+      {
+        for (uint32_t i = 0; i < L.second.size(); ++i) nos.emplace(L.second[i]->id, no(t,i));
+        ++t;
+      }
+    }
+
+    // Grava os ladrilhos
+    ofstream dat(dir + "/ladrilhos.dat", ios::binary | ios::trunc);
+    if (!dat.is_open()) throw 4;
+
+    vector<EntradaLadrilho> entradas;
+    uint64_t inicio = 0;
+    string buf, textos;
+    for (const auto& L : por_ladrilho)
+    {
+      vector<PontoLadrilho> pts;
+      vector<ArestaLadrilho> arestas;
+      vector<uint32_t> inicio_arestas;
+      textos.clear();
+
+      for (const Ponto* P : L.second)
+      {
+        ostringstream id;
+        id << P->id;
+        ostringstream nome;
+        nome << P->nome;
+        pts.push_back({P->latitude, P->longitude,
+                       incluiTexto(textos, id.str()), incluiTexto(textos, nome.str())});
+
+        inicio_arestas.push_back(arestas.size());
+        for (const Vizinho& V : grafo.at(P->id).rotas)
+        {
+          const NohMapa& S = grafo.at(V.id_pt);
+          ostringstream id_rota;
+          id_rota << V.id_rt;
+          arestas.push_back({V.comprimento, S.latitude, S.longitude, nos.at(V.id_pt),
+                             incluiTexto(textos, id_rota.str()), 0});
+        }
+      }
+      inicio_arestas.push_back(arestas.size());
+
+      CabecalhoLadrilho cab = {uint32_t(pts.size()), uint32_t(arestas.size())};
+      buf.assign(reinterpret_cast<const char*>(&cab), sizeof(cab));
+      grava(buf, pts);
+      grava(buf, arestas);
+      grava(buf, inicio_arestas);
+      buf += textos;
+      // Mantem o proximo ladrilho alinhado em 8 bytes
+      buf.resize((buf.size()+7) & ~size_t(7), '\0');
+
+      dat.write(buf.data(), buf.size());
+      entradas.push_back({L.first.first, L.first.second, inicio, buf.size()});
+      inicio += buf.size();
+    }
+    dat.close();
+    if (dat.fail()) throw 5;
+
+    // Diretorio: tabela de espalhamento com ocupacao de ateh 50%
+    uint64_t tam_diretorio = 1;
+    while (tam_diretorio < 2*pontos.size()) tam_diretorio *= 2;
+    vector<EntradaDiretorio> diretorio(tam_diretorio, {0, VAZIO});
+    for (const Ponto& P : pontos)
+    {
+      ostringstream id;
+      id << P.id;
+      uint64_t h = espalhamento(id.str());
+      uint64_t i = h & (tam_diretorio-1);
+      while (diretorio[i].no != VAZIO) i = (i+1) & (tam_diretorio-1);
+      diretorio[i] = {h, nos.at(P.id)};
+    }
+
+    // Grava o indice
+    CabecalhoIndice cab;
+    memcpy(cab.magica, MAGICA, sizeof(MAGICA));
+    cab.tam_graus = tam_graus;
+    cab.num_ladrilhos = entradas.size();
+    cab.num_pontos = pontos.size();
+    cab.tam_diretorio = tam_diretorio;
+
+    ofstream idx(dir + "/ladrilhos.idx", ios::binary | ios::trunc);
+    if (!idx.is_open()) throw 6;
+    buf.assign(reinterpret_cast<const char*>(&cab), sizeof(cab));
+    grava(buf, entradas);
+    grava(buf, diretorio);
+    idx.write(buf.data(), buf.size());
+    idx.close();
+    if (idx.fail()) throw 7;
+
+    return true;
+  }
+  catch (int i)
+  {
+    cerr << "Erro " << i << " na gravacao dos ladrilhos em " << dir << endl;
+    return false;
+  }
+}
+
+/* *************************
+   * CLASSE MAPALADRILHADO *
+   ************************* */
+
+/// Cria um mapa vazio
+MapaLadrilhado::MapaLadrilhado():
+  tam_graus(0.0), ladrilhos(), grade(), num_pontos(0), textos(),
+  arq_dados(), fd_dados(-1), fd_indice(-1), indice(nullptr), dados_indice(nullptr), tam_indice(0),
+  diretorio(nullptr), tam_diretorio(0),
+  lru(), memoria_usada(0), max_memoria(0),
+  num_carregamentos(0), num_precarregamentos(0),
+  linha_destino(0), coluna_destino(0), ultimo_expandido(0)
+{
+}
+
+/// Abre os ladrilhos gravados no diretorio dir
+MapaLadrilhado::MapaLadrilhado(const std::string& dir, size_t max_memoria):
+  MapaLadrilhado()
+{
+  abrir(dir, max_memoria);
+}
+
+/// Abre os ladrilhos gravados no diretorio dir.
+/// Caso nao consiga, deixa o mapa vazio e retorna false.
+bool MapaLadrilhado::abrir(const std::string& dir, size_t MaxMemoria)
+{
+  fechar();
+  max_memoria = MaxMemoria;
+
+  try
+  {
+    // Mapeia o indice: a tabela de ladrilhos eh lida na abertura e o
+    // diretorio eh consultado apenas nas origens e destinos das buscas
+    string arq_indice = dir + "/ladrilhos.idx";
+    arq_dados = dir + "/ladrilhos.dat";
+#if !defined(_WIN32)
+    fd_indice = open(arq_indice.c_str(), O_RDONLY);
+    if (fd_indice < 0) throw 1;
+    fd_dados = open(arq_dados.c_str(), O_RDONLY);
+    if (fd_dados < 0) throw 1;
+#endif
+    error_code erro;
+    tam_indice = filesystem::file_size(arq_indice, erro);
+    if (erro || tam_indice < sizeof(CabecalhoIndice)) throw 2;
+    uint64_t tam_dados = filesystem::file_size(arq_dados, erro);
+    if (erro) throw 2;
+    indice = mapeia(arq_indice, fd_indice, 0, tam_indice, dados_indice);
+    if (indice == nullptr) throw 2;
+
+    const CabecalhoIndice* cab = reinterpret_cast<const CabecalhoIndice*>(dados_indice);
+    if (memcmp(cab->magica, MAGICA, sizeof(MAGICA)) != 0) throw 3;
+    // Contadores limitados antes das multiplicacoes, para nao transbordarem
+    if (cab->num_ladrilhos > tam_indice/sizeof(EntradaLadrilho) ||
+        cab->tam_diretorio > tam_indice/sizeof(EntradaDiretorio)) throw 3;
+    if (tam_indice != sizeof(CabecalhoIndice) + cab->num_ladrilhos*sizeof(EntradaLadrilho)
+                      + cab->tam_diretorio*sizeof(EntradaDiretorio)) throw 3;
+    // O diretorio eh indexado por espalhamento & (tam_diretorio-1)
+    if (cab->tam_diretorio == 0 || (cab->tam_diretorio & (cab->tam_diretorio-1)) != 0) throw 3;
+
+    tam_graus = cab->tam_graus;
+    num_pontos = cab->num_pontos;
+    tam_diretorio = cab->tam_diretorio;
+    const EntradaLadrilho* E = reinterpret_cast<const EntradaLadrilho*>(cab+1);
+    diretorio = reinterpret_cast<const char*>(E + cab->num_ladrilhos);
+
+    for (uint32_t t = 0; t < cab->num_ladrilhos; ++t)
+    {
+      // Cada ladrilho deve estar inteiro no arquivo de dados: mapear alem
+      // do fim do arquivo termina o programa (SIGBUS) no primeiro acesso
+      if (E[t].inicio > tam_dados || E[t].tamanho > tam_dados - E[t].inicio ||
+          E[t].tamanho < sizeof(CabecalhoLadrilho)) throw 4;
+      ladrilhos.push_back({E[t].linha, E[t].coluna, E[t].inicio, E[t].tamanho,
+                           nullptr, nullptr, lru.end()});
+      grade.emplace(chave(E[t].linha, E[t].coluna), t);
+    }
+    if (ladrilhos.empty()) throw 5;
+    return true;
+  }
+  catch (int i)
+  {
+    cerr << "Erro " << i << " na abertura dos ladrilhos em " << dir << endl;
+    fechar();
+    return false;
+  }
+}
+
+/// Fecha os arquivos e descarrega todos os ladrilhos
+void MapaLadrilhado::fechar()
+{
+  while (!lru.empty()) descarrega(lru.back());
+  ladrilhos.clear();
+  grade.clear();
+  num_pontos = 0;
+  textos.reset();
+  if (indice != nullptr) desmapeia(indice, dados_indice, tam_indice);
+#if !defined(_WIN32)
+  if (fd_dados >= 0) close(fd_dados);
+  if (fd_indice >= 0) close(fd_indice);
+#endif
+  fd_dados = fd_indice = -1;
+  indice = nullptr;
+  dados_indice = nullptr;
+  tam_indice = 0;
+  diretorio = nullptr;
+  tam_diretorio = 0;
+  memoria_usada = 0;
+}
+
+/// Altera o limite de memoria dos ladrilhos carregados (em bytes)
+void MapaLadrilhado::setMaxMemoria(size_t MaxMemoria)
+{
+  max_memoria = MaxMemoria;
+  aplicaLimite();
+}
+
+/// Mapeia e confere o ladrilho t, sem inclui-lo no cache
+void MapaLadrilhado::mapeiaLadrilho(uint32_t t)
+{
+  Ladrilho& L = ladrilhos[t];
+  L.mapeado = mapeia(arq_dados, fd_dados, L.inicio, L.tamanho, L.dados);
+  if (L.mapeado == nullptr)
+  {
+    L.dados = nullptr;
+    cerr << "Erro no mapeamento do ladrilho " << t << endl;
+    throw 2;
+  }
+  if (!ladrilhoValido(L.dados, L.tamanho))
+  {
+    desmapeia(L.mapeado, L.dados, L.tamanho);
+    L.dados = nullptr;
+    L.mapeado = nullptr;
+    cerr << "Erro no ladrilho " << t << ": conteudo invalido" << endl;
+    throw 2;
+  }
+}
+
+/// Retorna o conteudo do ladrilho t, carregando-o se necessario,
+/// e o torna o mais recente no cache
+const char* MapaLadrilhado::carrega(uint32_t t)
+{
+  if (t >= ladrilhos.size())
+  {
+    cerr << "Erro no ladrilho " << t << ": inexistente" << endl;
+    throw 2;
+  }
+  Ladrilho& L = ladrilhos[t];
+  if (L.dados != nullptr)
+  {
+    lru.splice(lru.begin(), lru, L.lru);
+    return L.dados;
+  }
+
+  mapeiaLadrilho(t);
+  lru.push_front(t);
+  L.lru = lru.begin();
+  memoria_usada += L.tamanho;
+  ++num_carregamentos;
+  aplicaLimite();
+  return L.dados;
+}
+
+/// Carrega o ladrilho t como o menos recente do cache e avisa o sistema que
+/// sera lido em breve. Para abrir espaco, descarta apenas ladrilhos menos
+/// recentes que o mais recente (o ladrilho em expansao); se ainda assim nao
+/// couber, o pre-carregamento eh abandonado.
+void MapaLadrilhado::preCarrega(uint32_t t)
+{
+  Ladrilho& L = ladrilhos[t];
+  if (L.dados != nullptr) return;
+  while (lru.size() > 1 && memoria_usada + L.tamanho > max_memoria) descarrega(lru.back());
+  if (memoria_usada + L.tamanho > max_memoria) return;
+
+  try
+  {
+    mapeiaLadrilho(t);
+  }
+  catch (int)
+  {
+    // Erro jah reportado: a busca soh falha se precisar do ladrilho
+    return;
+  }
+  lru.push_back(t);
+  L.lru = prev(lru.end());
+  memoria_usada += L.tamanho;
+  antecipaLeitura(L.mapeado, L.dados, L.tamanho);
+  ++num_precarregamentos;
+}
+
+/// Descarrega o ladrilho t
+void MapaLadrilhado::descarrega(uint32_t t)
+{
+  Ladrilho& L = ladrilhos[t];
+  if (L.dados == nullptr) return;
+  desmapeia(L.mapeado, L.dados, L.tamanho);
+  L.dados = nullptr;
+  L.mapeado = nullptr;
+  lru.erase(L.lru);
+  L.lru = lru.end();
+  memoria_usada -= L.tamanho;
+}
+
+/// Descarta os ladrilhos menos recentes ateh respeitar o limite de memoria
+/// (o mais recente nunca eh descartado)
+void MapaLadrilhado::aplicaLimite()
+{
+  while (lru.size() > 1 && memoria_usada > max_memoria) descarrega(lru.back());
+}
+
+/// Pre-carrega o ladrilho vizinho a t na direcao do destino
+void MapaLadrilhado::preCarregaDirecao(uint32_t t)
+{
+  const Ladrilho& L = ladrilhos[t];
+  int32_t dl = (linha_destino > L.linha) - (linha_destino < L.linha);
+  int32_t dc = (coluna_destino > L.coluna) - (coluna_destino < L.coluna);
+  if (dl == 0 && dc == 0) return;
+
+  auto it = grade.find(chave(L.linha + dl, L.coluna + dc));
+  if (it != grade.end()) preCarrega(it->second);
+}
+
+/// Procura um ponto no diretorio.
+/// Retorna false se a id nao existir.
+bool MapaLadrilhado::procura(const IDPonto& Id, uint64_t& n)
+{
+  if (empty() || !Id.valid()) return false;
+
+  ostringstream id;
+  id << Id;
+  const string S = id.str();
+  uint64_t h = espalhamento(S);
+  const EntradaDiretorio* D = reinterpret_cast<const EntradaDiretorio*>(diretorio);
+  for (uint64_t i = h & (tam_diretorio-1); D[i].no != VAZIO; i = (i+1) & (tam_diretorio-1))
+  {
+    if (D[i].espalhamento != h) continue;
+    // Confere a id no ladrilho do ponto
+    VisaoLadrilho V(carrega(ladrilhoDe(D[i].no)));
+    if (indiceDe(D[i].no) >= V.cab->num_pontos) continue;
+    if (S == V.textos + V.pontos[indiceDe(D[i].no)].id)
+    {
+      n = D[i].no;
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Texto de uma id ou nome lido de um ladrilho: o do pool global, se existir
+/// (ex.: ids das consultas), ou o do pool do mapa, sem crescer o pool global
+Texto MapaLadrilhado::texto(const char* S)
+{
+  Texto T = Texto::procura(S);
+  if (T.empty() && *S != '\0')
+  {
+    if (!textos) textos.reset(new PoolTextos);
+    T = Texto(S, *textos);
+  }
+  return T;
+}
+
+/// Retorna um Ponto do mapa, passando a id como parametro.
+/// Se a id for inexistente, retorna um Ponto vazio.
+Ponto MapaLadrilhado::getPonto(const IDPonto& Id)
+{
+  Ponto P;
+  try
+  {
+    uint64_t n;
+    if (!procura(Id, n)) return P;
+
+    VisaoLadrilho V(carrega(ladrilhoDe(n)));
+    const PontoLadrilho& PL = V.pontos[indiceDe(n)];
+    P.id = Id;
+    P.nome = texto(V.textos + PL.nome);
+    P.latitude = PL.latitude;
+    P.longitude = PL.longitude;
+  }
+  catch (int)
+  {
+    // Erro na leitura do ladrilho: jah reportado por carrega
+    P = Ponto();
+  }
+  return P;
+}
+
+/// O mapa em ladrilhos visto pelo algoritmo A* (ver planejador-busca.h)
+struct GrafoLadrilhos
+{
+  using No = uint64_t;    // <ladrilho,indice do ponto>
+  using Rota = uint64_t;  // <ladrilho,posicao da id da rota em textos>
+
+  MapaLadrilhado& M;
+
+  /// Indice do ponto n no seu ladrilho, jah carregado em V. Os vizinhos das
+  /// arestas apontam para outros ladrilhos, que nao sao conferidos ao abrir o mapa
+  static uint32_t indice(const VisaoLadrilho& V, No n)
+  {
+    uint32_t i = indiceDe(n);
+    if (i >= V.cab->num_pontos)
+    {
+      cerr << "Erro no ladrilho " << ladrilhoDe(n) << ": ponto " << i << " inexistente" << endl;
+      throw 2;
+    }
+    return i;
+  }
+
+  void coordenadas(No n, double& lat, double& lon)
+  {
+    VisaoLadrilho V(M.carrega(ladrilhoDe(n)));
+    uint32_t i = indice(V, n);
+    lat = V.pontos[i].latitude;
+    lon = V.pontos[i].longitude;
+  }
+
+  template<class F>
+  void paraCadaRota(No n, F f)
+  {
+    uint32_t t = ladrilhoDe(n);
+    // t eh carregado como o mais recente antes do pre-carregamento, que nunca
+    // descarta o mais recente: V continua valida enquanto as arestas sao percorridas
+    VisaoLadrilho V(M.carrega(t));
+    // Ao entrar num novo ladrilho, antecipa a leitura do proximo na direcao do destino
+    if (t != M.ultimo_expandido)
+    {
+      M.preCarregaDirecao(t);
+      M.ultimo_expandido = t;
+    }
+
+    uint32_t i = indice(V, n);
+    for (uint32_t k = V.inicio_arestas[i]; k < V.inicio_arestas[i+1]; ++k)
+    {
+      const ArestaLadrilho& A = V.arestas[k];
+      f(no(t, A.id_rota), A.vizinho, A.comprimento, A.latitude, A.longitude);
+    }
+  }
+
+  IDPonto idPonto(No n)
+  {
+    VisaoLadrilho V(M.carrega(ladrilhoDe(n)));
+    IDPonto Id;
+    Id.set(M.texto(V.textos + V.pontos[indice(V, n)].id));
+    return Id;
+  }
+
+  IDRota idRota(Rota r)
+  {
+    VisaoLadrilho V(M.carrega(ladrilhoDe(r)));
+    IDRota Id;
+    Id.set(M.texto(V.textos + indiceDe(r)));
+    return Id;
+  }
+};
+
+/// Calcula o caminho mais curto no mapa entre origem e destino, usando o algoritmo A*
+double MapaLadrilhado::calculaCaminho(const IDPonto& id_origem,
+                                      const IDPonto& id_destino,
+                                      Caminho& C, int& NA, int& NF)
+{
+    // Zera o caminho resultado
+    C.clear();
+
+    try {
+        // Verificações iniciais
+        if (empty()) throw 1;
+
+        uint64_t orig, dest;
+        if (!procura(id_origem, orig)) throw 4;
+        if (!procura(id_destino, dest)) throw 5;
+
+        // Ladrilho do destino, para o pre-carregamento
+        linha_destino = ladrilhos[ladrilhoDe(dest)].linha;
+        coluna_destino = ladrilhos[ladrilhoDe(dest)].coluna;
+        ultimo_expandido = ladrilhoDe(orig);
+
+        GrafoLadrilhos G{*this};
+        return buscaAEstrela(G, orig, dest, C, NA, NF);
+    } catch (int i) {
+        cerr << "Erro " << i << " no calculo do caminho\n";
+        NA = NF = -1;
+        return -1.0;
+    }
+}
@@ -0,0 +1,167 @@
+#ifndef _PLANEJADOR_LADRILHOS_H_
+#define _PLANEJADOR_LADRILHOS_H_
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include <memory>
+
+#include "planejador.h"
+
+/* *************************
+   * CLASSE MAPALADRILHADO *
+   ************************* */
+
+/// Um mapa armazenado em disco, dividido em ladrilhos (tiles) geograficos de
+/// tam_graus x tam_graus graus, para mapas maiores que a memoria disponivel.
+/// Os arquivos sao gerados por Planejador::salvarLadrilhos.
+/// A busca carrega (mmap) os ladrilhos sob demanda e os mantem num cache LRU
+/// limitado a max_memoria bytes; ao expandir um ladrilho, o ladrilho vizinho
+/// na direcao do destino eh pre-carregado.
+/// Os caminhos e comprimentos calculados sao os mesmos de Planejador::calculaCaminho.
+/// As ids e nomes retornados que ainda nao estao no pool global de textos ficam
+/// num pool do proprio mapa, liberado em fechar: sao validos enquanto o mapa
+/// estiver aberto e nao sao iguais (==) a ids criadas depois com o mesmo texto.
+/// Nao deve ser usado por varias threads ao mesmo tempo.
+class MapaLadrilhado
+{
+private:
+  /// Um ladrilho do arquivo de dados
+  struct Ladrilho
+  {
+    int32_t linha;        // Posicao do ladrilho na grade (latitude)
+    int32_t coluna;       // Posicao do ladrilho na grade (longitude)
+    uint64_t inicio;      // Posicao no arquivo de dados
+    uint64_t tamanho;     // Tamanho no arquivo de dados (em bytes)
+    const char* dados;    // Conteudo do ladrilho, nullptr se nao estah carregado
+    void* mapeado;        // Regiao mapeada (comeca no inicio da pagina de dados)
+    std::list<uint32_t>::iterator lru;  // Posicao no cache
+  };
+
+  double tam_graus;                     // Tamanho dos ladrilhos (em graus)
+  std::vector<Ladrilho> ladrilhos;
+  std::unordered_map<uint64_t, uint32_t> grade;  // <linha,coluna> -> ladrilho
+  uint64_t num_pontos;
+
+  // Pool das ids e nomes retornados que nao estao no pool global
+  // (criado no primeiro uso)
+  std::unique_ptr<PoolTextos> textos;
+
+  // Arquivos abertos. O diretorio de pontos eh uma tabela de espalhamento
+  // id -> ponto no arquivo de indice.
+  std::string arq_dados;
+  int fd_dados;
+  int fd_indice;
+  void* indice;                         // Arquivo de indice mapeado
+  const char* dados_indice;
+  size_t tam_indice;
+  const char* diretorio;
+  uint64_t tam_diretorio;
+
+  // Cache LRU: ladrilhos carregados, do usado mais recentemente ao menos recente
+  std::list<uint32_t> lru;
+  size_t memoria_usada;
+  size_t max_memoria;
+  size_t num_carregamentos;
+  size_t num_precarregamentos;
+
+  // Ladrilho do destino da busca em andamento e ultimo ladrilho expandido
+  int32_t linha_destino, coluna_destino;
+  uint32_t ultimo_expandido;
+
+  /// Mapeia e confere o ladrilho t, sem inclui-lo no cache
+  void mapeiaLadrilho(uint32_t t);
+  /// Retorna o conteudo do ladrilho t, carregando-o se necessario,
+  /// e o torna o mais recente no cache
+  const char* carrega(uint32_t t);
+  /// Carrega o ladrilho t como o menos recente do cache, se couber sem
+  /// descartar o mais recente, e avisa o sistema que sera lido em breve
+  void preCarrega(uint32_t t);
+  /// Descarrega o ladrilho t
+  void descarrega(uint32_t t);
+  /// Descarta os ladrilhos menos recentes ateh respeitar o limite de memoria
+  /// (o mais recente nunca eh descartado)
+  void aplicaLimite();
+  /// Pre-carrega o ladrilho vizinho a t na direcao do destino
+  void preCarregaDirecao(uint32_t t);
+  /// Procura um ponto no diretorio.
+  /// Retorna false se a id nao existir.
+  bool procura(const IDPonto& Id, uint64_t& no);
+  /// Texto de uma id ou nome lido de um ladrilho: o do pool global, se existir,
+  /// ou o do pool do mapa
+  Texto texto(const char* S);
+
+  // A busca A* percorre os ladrilhos
+  friend struct GrafoLadrilhos;
+
+public:
+  /// Cria um mapa vazio
+  MapaLadrilhado();
+  /// Abre os ladrilhos gravados no diretorio dir
+  MapaLadrilhado(const std::string& dir, size_t max_memoria = 256*1024*1024);
+  /// Fecha os arquivos
+  ~MapaLadrilhado()
+  {
+    fechar();
+  }
+  // Nao copiavel: possui arquivos abertos e regioes mapeadas
+  MapaLadrilhado(const MapaLadrilhado&) = delete;
+  MapaLadrilhado& operator=(const MapaLadrilhado&) = delete;
+
+  /// Abre os ladrilhos gravados no diretorio dir.
+  /// Caso nao consiga, deixa o mapa vazio e retorna false.
+  bool abrir(const std::string& dir, size_t max_memoria = 256*1024*1024);
+
+  /// Fecha os arquivos e descarrega todos os ladrilhos
+  void fechar();
+
+  /// Testa se um mapa estah vazio
+  bool empty() const
+  {
+    return ladrilhos.empty();
+  }
+
+  /// Altera o limite de memoria dos ladrilhos carregados (em bytes)
+  void setMaxMemoria(size_t MaxMemoria);
+
+  /// Retorna um Ponto do mapa, passando a id como parametro.
+  /// Se a id for inexistente, retorna um Ponto vazio.
+  Ponto getPonto(const IDPonto& Id);
+
+  /// Calcula o caminho mais curto no mapa entre origem e destino, usando o algoritmo A*
+  /// Retorno e parametros como em Planejador::calculaCaminho.
+  double calculaCaminho(const IDPonto& id_origem,
+                        const IDPonto& id_destino,
+                        Caminho& C, int& NA, int& NF);
+
+  /// Estatisticas do cache de ladrilhos
+  size_t numLadrilhos() const
+  {
+    return ladrilhos.size();
+  }
+  size_t numCarregados() const
+  {
+    return lru.size();
+  }
+  size_t memoria() const
+  {
+    return memoria_usada;
+  }
+  size_t numCarregamentos() const
+  {
+    return num_carregamentos;
+  }
+  size_t numPreCarregamentos() const
+  {
+    return num_precarregamentos;
+  }
+  /// Memoria do pool das ids e nomes retornados (em bytes), fora de max_memoria
+  size_t memoriaTextos() const
+  {
+    return (textos ? textos->memoria() : 0);
+  }
+};
+
+#endif // _PLANEJADOR_LADRILHOS_H_
@@ -1,7 +1,6 @@
 #include <iostream>
 #include <chrono>
 #include "planejador.h"
-#include "planejador.cpp"
 
 using namespace std;
 
@@ -19,7 +18,7 @@ int main()
   // O tempo de calculo do caminho
   double deltaT;
 
-  if (!G.ler("pontos.txt", "rotas.txt"))
+  if (!G.lerParalelo("pontos.txt", "rotas.txt"))
   {
     cerr << "Erro na leitura dos arquivos do mapa\n";
     return -1;
@@ -30,6 +29,9 @@ int main()
   Rota R;
   Ponto P;
   string S;
+  // Os pontos alcancaveis a partir de uma origem e a distancia maxima
+  Alcancaveis A;
+  double dist_max;
 
   int opcao;
   do
@@ -38,13 +40,14 @@ int main()
     cout << "1 - Imprimir pontos\n";
     cout << "2 - Imprimir rotas\n";
     cout << "3 - Calcular e imprimir caminho\n";
+    cout << "4 - Calcular e imprimir pontos alcancaveis\n";
     cout << "0 - Sair\n";
     do
     {
       cout << "OPCAO: ";
       cin >> opcao;
     }
-    while (opcao<0 || opcao>3);
+    while (opcao<0 || opcao>4);
     switch(opcao)
     {
     case 1:
@@ -124,6 +127,50 @@ int main()
       }
 
 
+      break;
+    case 4:
+      do
+      {
+        cout << "ID do ponto de origem: ";
+        cin >> S;
+        id_origem.set(move(S));
+      } while (!id_origem.valid());
+      do
+      {
+        cout << "Distancia maxima (km): ";
+        cin >> dist_max;
+      } while (!(dist_max>=0.0));
+
+      // Calcula o tempo de execucao do calculo do alcance
+      {
+        using namespace chrono;
+
+        steady_clock::time_point t1 = steady_clock::now();
+        G.calculaAlcance(id_origem,dist_max,A);
+        steady_clock::time_point t2 = steady_clock::now();
+        duration<double> time_span = duration_cast<duration<double>>(t2 - t1);
+        deltaT = 1000*time_span.count();
+      }
+
+      cout << "Tempo: " << deltaT << "ms\t"
+           << "Pontos alcancados: " << A.size() << endl;
+
+      // Imprime os pontos alcancados, do mais proximo ao mais distante
+      if (!A.empty())
+      {
+        cout << "==========\n";
+        for (const auto& a : A)
+        {
+          P = G.getPonto(a.id_pt);
+          cout << a.dist << "km\t" << P.nome;
+          if (a.id_rt != IDRota())
+          {
+            R = G.getRota(a.id_rt);
+            cout << " (por " << R.nome << ")";
+          }
+          cout << endl;
+        }
+      }
       break;
     case 0:
     default:
@@ -0,0 +1,454 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <thread>
+
+#include "planejador.h"
+#include "planejador-tabela.h"
+#include "planejador-busca.h"
+
+using namespace std;
+
+namespace
+{
+const char MAGICA[8] = {'P','L','A','N','T','A','B','1'};
+const double INFINITO = numeric_limits<double>::infinity();
+
+/// Limites de pontos fechados em cada busca de testemunha: ao simular a
+/// contracao de um ponto (para calcular sua prioridade) e ao contrai-lo.
+/// Uma busca interrompida apenas acrescenta um atalho desnecessario.
+const unsigned MAX_TESTEMUNHA_SIMULACAO = 50;
+const unsigned MAX_TESTEMUNHA_CONTRACAO = 500;
+
+/// Uma rota (ou atalho) ateh o ponto v
+struct Aresta
+{
+  uint32_t v;
+  double w;
+};
+
+/// Acrescenta a aresta ateh v em L, ou reduz seu comprimento se jah existir.
+/// Retorna true se a aresta eh nova.
+bool acrescenta(vector<Aresta>& L, uint32_t v, double w)
+{
+  for (Aresta& A : L)
+  {
+    if (A.v == v)
+    {
+      A.w = min(A.w, w);
+      return false;
+    }
+  }
+  L.push_back({v, w});
+  return true;
+}
+
+/// Relaxa as distancias de um lote de origens ateh um ponto (dp) pela rota de
+/// comprimento w que vem de outro ponto (dt). As duas linhas nunca se sobrepoem,
+/// o que permite ao compilador vetorizar o laco.
+template<unsigned TAM>
+inline void relaxaLote(double* __restrict dp, const double* __restrict dt, double w)
+{
+  for (unsigned l = 0; l < TAM; ++l)
+  {
+    dp[l] = min(dp[l], dt[l]+w);
+  }
+}
+
+/// Contracao dos pontos de um grafo nao orientado, do menos ao mais importante.
+/// Ao contrair um ponto v, cada par de vizinhos u,w de v que deixaria de ter um
+/// caminho tao curto quanto u-v-w recebe um atalho u-w.
+/// A importancia combina a diferenca entre atalhos criados e rotas removidas,
+/// o numero de vizinhos jah contraidos e o nivel do ponto na hierarquia
+/// (os dois ultimos espalham a contracao pelo mapa).
+class Contracao
+{
+private:
+  vector< vector<Aresta> > adj;   // Arestas entre pontos ainda nao contraidos
+  vector<bool> contraido;
+  vector<int> vizinhos_contraidos;
+  vector<int> nivel;              // 1 + maior nivel dos vizinhos jah contraidos
+
+  // Area de trabalho das buscas de testemunha
+  vector<double> dist;
+  vector<uint32_t> tocados;
+  vector<bool> alvo;
+  vector< pair<double,uint32_t> > heap;
+
+  /// Dijkstra a partir de u sem passar por ignorado, ateh fechar os num_alvos
+  /// pontos marcados em alvo, passar da distancia limite ou fechar max_fechados
+  /// pontos. Deixa as distancias em dist.
+  void testemunha(uint32_t u, uint32_t ignorado, double limite,
+                  unsigned max_fechados, size_t num_alvos)
+  {
+    dist[u] = 0.0;
+    tocados.push_back(u);
+    heap.assign(1, {0.0, u});
+    unsigned num_fechados(0);
+    while (!heap.empty() && num_fechados < max_fechados)
+    {
+      pop_heap(heap.begin(), heap.end(), greater< pair<double,uint32_t> >());
+      auto [d, x] = heap.back();
+      heap.pop_back();
+      if (d > dist[x]) continue;
+      if (d > limite) break;
+      if (alvo[x] && --num_alvos == 0) break;
+      ++num_fechados;
+      for (const Aresta& A : adj[x])
+      {
+        if (A.v == ignorado || d+A.w >= dist[A.v]) continue;
+        if (dist[A.v] == INFINITO) tocados.push_back(A.v);
+        dist[A.v] = d+A.w;
+        heap.push_back({dist[A.v], A.v});
+        push_heap(heap.begin(), heap.end(), greater< pair<double,uint32_t> >());
+      }
+    }
+  }
+
+  /// Restaura dist apos uma busca de testemunha
+  void limpa()
+  {
+    for (uint32_t x : tocados) dist[x] = INFINITO;
+    tocados.clear();
+  }
+
+  /// Conta os atalhos necessarios para contrair v, guardando-os em novos (se nao nulo)
+  int atalhos(uint32_t v, unsigned max_fechados,
+              vector< pair<uint32_t,Aresta> >* novos)
+  {
+    const vector<Aresta>& N = adj[v];
+    int num(0);
+    for (size_t i = 0; i+1 < N.size(); ++i)
+    {
+      double limite(0.0);
+      for (size_t j = i+1; j < N.size(); ++j) limite = max(limite, N[i].w+N[j].w);
+      for (size_t j = i+1; j < N.size(); ++j) alvo[N[j].v] = true;
+      testemunha(N[i].v, v, limite, max_fechados, N.size()-i-1);
+      for (size_t j = i+1; j < N.size(); ++j) alvo[N[j].v] = false;
+      for (size_t j = i+1; j < N.size(); ++j)
+      {
+        double via = N[i].w+N[j].w;
+        if (dist[N[j].v] > via)
+        {
+          ++num;
+          if (novos != nullptr) novos->push_back({N[i].v, {N[j].v, via}});
+        }
+      }
+      limpa();
+    }
+    return num;
+  }
+
+  int prioridade(uint32_t v)
+  {
+    return 4*(atalhos(v, MAX_TESTEMUNHA_SIMULACAO, nullptr) - int(adj[v].size()))
+           + vizinhos_contraidos[v] + 2*nivel[v];
+  }
+
+public:
+  /// Arestas de cada ponto para os vizinhos ainda nao contraidos no momento
+  /// em que foi contraido (as que sobem na hierarquia)
+  vector< vector<Aresta> > subida;
+  /// Pontos em ordem de contracao
+  vector<uint32_t> ordem;
+  size_t num_atalhos;
+
+  explicit Contracao(vector< vector<Aresta> >&& Adj):
+    adj(move(Adj)), contraido(adj.size(), false), vizinhos_contraidos(adj.size(), 0),
+    nivel(adj.size(), 0), dist(adj.size(), INFINITO), tocados(), alvo(adj.size(), false), heap(),
+    subida(adj.size()), ordem(), num_atalhos(0)
+  {
+  }
+
+  void executa()
+  {
+    // Fila de prioridade com atualizacao preguicosa: a prioridade do topo eh
+    // recalculada antes da contracao e, se aumentou alem da do proximo, o ponto
+    // volta para a fila
+    typedef pair<int,uint32_t> Entrada;
+    vector<int> prio(adj.size());
+    vector<Entrada> fila;
+    fila.reserve(adj.size());
+    for (uint32_t v = 0; v < adj.size(); ++v)
+    {
+      prio[v] = prioridade(v);
+      fila.push_back({prio[v], v});
+    }
+    make_heap(fila.begin(), fila.end(), greater<Entrada>());
+
+    vector< pair<uint32_t,Aresta> > novos;
+    ordem.reserve(adj.size());
+    while (!fila.empty())
+    {
+      pop_heap(fila.begin(), fila.end(), greater<Entrada>());
+      auto [p, v] = fila.back();
+      fila.pop_back();
+      if (contraido[v] || p != prio[v]) continue;
+      int p_atual = prioridade(v);
+      if (p_atual > p && !fila.empty() && p_atual > fila.front().first)
+      {
+        prio[v] = p_atual;
+        fila.push_back({p_atual, v});
+        push_heap(fila.begin(), fila.end(), greater<Entrada>());
+        continue;
+      }
+
+      // Contrai v
+      novos.clear();
+      atalhos(v, MAX_TESTEMUNHA_CONTRACAO, &novos);
+      contraido[v] = true;
+      ordem.push_back(v);
+      subida[v] = move(adj[v]);
+      adj[v].clear();
+      for (const Aresta& A : subida[v])
+      {
+        vector<Aresta>& L = adj[A.v];
+        L.erase(find_if(L.begin(), L.end(), [v](const Aresta& B) { return B.v == v; }));
+        ++vizinhos_contraidos[A.v];
+        nivel[A.v] = max(nivel[A.v], nivel[v]+1);
+      }
+      for (const auto& [u, A] : novos)
+      {
+        if (acrescenta(adj[u], A.v, A.w)) ++num_atalhos;
+        acrescenta(adj[A.v], u, A.w);
+      }
+    }
+  }
+};
+}
+
+/* ***************************
+   * CLASSE TABELADISTANCIAS *
+   *************************** */
+
+/// Cria uma tabela vazia
+TabelaDistancias::TabelaDistancias():
+  posicao(), inicio_subida(), destino_subida(), peso_subida(), num_atalhos(0)
+{
+}
+
+/// Cria uma tabela preparada para o mapa
+TabelaDistancias::TabelaDistancias(const Planejador& Mapa):
+  TabelaDistancias()
+{
+  preparar(Mapa);
+}
+
+/// Ordena os pontos do mapa e monta o grafo de subida.
+bool TabelaDistancias::preparar(const Planejador& Mapa)
+{
+  posicao.clear();
+  inicio_subida.clear();
+  destino_subida.clear();
+  peso_subida.clear();
+  num_atalhos = 0;
+  if (Mapa.empty()) return false;
+
+  // Numera os pontos na ordem do arquivo e monta o grafo sem rotas paralelas
+  // (fica a mais curta) nem lacos
+  unordered_map<IDPonto, uint32_t> numero;
+  numero.reserve(Mapa.pontos.size());
+  for (const Ponto& P : Mapa.pontos) numero.emplace(P.id, numero.size());
+  const uint32_t n = numero.size();
+  vector< vector<Aresta> > adj(n);
+  for (const auto& [id, N] : Mapa.grafo)
+  {
+    uint32_t u = numero.at(id);
+    for (const auto& V : N.rotas)
+    {
+      uint32_t v = numero.at(V.id_pt);
+      if (v != u) acrescenta(adj[u], v, V.comprimento);
+    }
+  }
+
+  Contracao C(move(adj));
+  C.executa();
+  num_atalhos = C.num_atalhos;
+
+  // O ultimo ponto contraido eh o mais importante (posicao 0)
+  vector<uint32_t> pos(n);
+  for (uint32_t r = 0; r < n; ++r) pos[C.ordem[r]] = n-1-r;
+  inicio_subida.reserve(n+1);
+  inicio_subida.push_back(0);
+  for (uint32_t p = 0; p < n; ++p)
+  {
+    for (const Aresta& A : C.subida[C.ordem[n-1-p]])
+    {
+      destino_subida.push_back(pos[A.v]);
+      peso_subida.push_back(A.w);
+    }
+    inicio_subida.push_back(destino_subida.size());
+  }
+  for (auto& par : numero) par.second = pos[par.second];
+  posicao = move(numero);
+  return true;
+}
+
+/// Converte ids em posicoes. Retorna false se alguma id nao existir no mapa.
+bool TabelaDistancias::posicoes(const vector<IDPonto>& ids, vector<uint32_t>& P) const
+{
+  P.resize(ids.size());
+  for (size_t i = 0; i < ids.size(); ++i)
+  {
+    auto it = posicao.find(ids[i]);
+    if (it == posicao.end()) return false;
+    P[i] = it->second;
+  }
+  return true;
+}
+
+/// Calcula as linhas das origens O[0] ... O[num-1] (num <= TAM_LOTE).
+void TabelaDistancias::calculaLote(const uint32_t* O, size_t num,
+                                   const vector<uint32_t>& destinos,
+                                   double* linhas, vector<double>& d) const
+{
+  // d[p*TAM_LOTE+l]: distancia da origem l ao ponto de posicao p.
+  // As distancias de um ponto para todo o lote ocupam uma linha de cache.
+  const size_t n = inicio_subida.size()-1;
+  d.assign(n*TAM_LOTE, INFINITO);
+
+  // Buscas de Dijkstra a partir de cada origem, apenas subindo na hierarquia
+  vector< pair<double,uint32_t> > heap;
+  for (size_t l = 0; l < num; ++l)
+  {
+    d[size_t(O[l])*TAM_LOTE+l] = 0.0;
+    heap.assign(1, {0.0, O[l]});
+    while (!heap.empty())
+    {
+      pop_heap(heap.begin(), heap.end(), greater< pair<double,uint32_t> >());
+      auto [dist, p] = heap.back();
+      heap.pop_back();
+      if (dist > d[size_t(p)*TAM_LOTE+l]) continue;
+      for (uint32_t e = inicio_subida[p]; e < inicio_subida[p+1]; ++e)
+      {
+        double& dt = d[size_t(destino_subida[e])*TAM_LOTE+l];
+        if (dist+peso_subida[e] < dt)
+        {
+          dt = dist+peso_subida[e];
+          heap.push_back({dt, destino_subida[e]});
+          push_heap(heap.begin(), heap.end(), greater< pair<double,uint32_t> >());
+        }
+      }
+    }
+  }
+
+  // Varredura do mais importante ao menos importante: as distancias dos pontos
+  // acima de p jah sao definitivas, e o caminho mais curto ateh p desce
+  // por uma das rotas de subida de p
+  for (size_t p = 0; p < n; ++p)
+  {
+    for (uint32_t e = inicio_subida[p]; e < inicio_subida[p+1]; ++e)
+    {
+      relaxaLote<TAM_LOTE>(&d[p*TAM_LOTE], &d[size_t(destino_subida[e])*TAM_LOTE], peso_subida[e]);
+    }
+  }
+
+  for (size_t l = 0; l < num; ++l)
+  {
+    for (size_t j = 0; j < destinos.size(); ++j)
+    {
+      double dist = d[size_t(destinos[j])*TAM_LOTE+l];
+      linhas[l*destinos.size()+j] = (dist == INFINITO ? -1.0 : dist);
+    }
+  }
+}
+
+/// Calcula as linhas das origens O[0] ... O[num-1] com num_threads threads
+void TabelaDistancias::calculaLinhas(const uint32_t* O, size_t num,
+                                     const vector<uint32_t>& destinos,
+                                     double* linhas, unsigned num_threads) const
+{
+  const size_t num_lotes = (num+TAM_LOTE-1)/TAM_LOTE;
+  if (num_threads == 0) num_threads = thread::hardware_concurrency();
+  num_threads = max(1u, num_threads);
+
+  // Cada tarefa calcula lotes consecutivos reaproveitando a mesma area de
+  // trabalho. Algumas tarefas por thread equilibram a carga.
+  const size_t num_tarefas = min<size_t>(num_lotes, 4*num_threads);
+  executaEmParalelo(num_tarefas, num_threads, [&](size_t k) {
+    vector<double> d;
+    for (size_t b = k*num_lotes/num_tarefas; b < (k+1)*num_lotes/num_tarefas; ++b)
+    {
+      calculaLote(O + b*TAM_LOTE, min<size_t>(TAM_LOTE, num-b*TAM_LOTE), destinos,
+                  linhas + b*TAM_LOTE*destinos.size(), d);
+    }
+  });
+}
+
+/// Calcula as distancias minimas de todas as origens a todos os destinos
+bool TabelaDistancias::calculaTabela(const vector<IDPonto>& origens,
+                                     const vector<IDPonto>& destinos,
+                                     vector<double>& D,
+                                     unsigned num_threads) const
+{
+  D.clear();
+  try
+  {
+    // Tabela nao preparada
+    if (empty()) throw 1;
+    vector<uint32_t> O, Dst;
+    // Origem invalida ou inexistente
+    if (!posicoes(origens, O)) throw 4;
+    // Destino invalido ou inexistente
+    if (!posicoes(destinos, Dst)) throw 5;
+
+    D.resize(O.size()*Dst.size());
+    calculaLinhas(O.data(), O.size(), Dst, D.data(), num_threads);
+    return true;
+  }
+  catch(int i)
+  {
+    cerr << "Erro " << i << " no calculo da tabela\n";
+    return false;
+  }
+}
+
+/// Calcula a tabela de distancias e a grava no arquivo binario arq
+bool TabelaDistancias::gravarTabela(const string& arq,
+                                    const vector<IDPonto>& origens,
+                                    const vector<IDPonto>& destinos,
+                                    unsigned num_threads) const
+{
+  try
+  {
+    if (empty()) throw 1;
+    vector<uint32_t> O, Dst;
+    if (!posicoes(origens, O)) throw 4;
+    if (!posicoes(destinos, Dst)) throw 5;
+
+    ofstream saida(arq, ios::binary);
+    if (!saida.is_open()) throw 2;
+    uint64_t num_origens(O.size()), num_destinos(Dst.size());
+    saida.write(MAGICA, sizeof(MAGICA));
+    saida.write(reinterpret_cast<const char*>(&num_origens), sizeof(num_origens));
+    saida.write(reinterpret_cast<const char*>(&num_destinos), sizeof(num_destinos));
+
+    // Calcula e grava um bloco de linhas de cada vez, com lotes suficientes
+    // para ocupar todas as threads
+    unsigned threads = (num_threads == 0 ? thread::hardware_concurrency() : num_threads);
+    const size_t linhas_bloco = 4*TAM_LOTE*max(1u, threads);
+    vector<double> bloco;
+    for (size_t i = 0; i < O.size() && saida; i += linhas_bloco)
+    {
+      size_t num = min(linhas_bloco, O.size()-i);
+      bloco.resize(num*Dst.size());
+      calculaLinhas(O.data()+i, num, Dst, bloco.data(), num_threads);
+      saida.write(reinterpret_cast<const char*>(bloco.data()), bloco.size()*sizeof(double));
+    }
+
+    for (const IDPonto& Id : origens) saida << Id << '\0';
+    for (const IDPonto& Id : destinos) saida << Id << '\0';
+    saida.close();
+    if (!saida) throw 3;
+    return true;
+  }
+  catch(int i)
+  {
+    cerr << "Erro " << i << " na gravacao da tabela em " << arq << endl;
+    return false;
+  }
+}
@@ -0,0 +1,107 @@
+#ifndef _PLANEJADOR_TABELA_H_
+#define _PLANEJADOR_TABELA_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "planejador.h"
+
+/* ***************************
+   * CLASSE TABELADISTANCIAS *
+   *************************** */
+
+/// Calcula tabelas (matrizes) de distancias minimas entre muitas origens e muitos
+/// destinos de um mapa.
+/// Em preparar, os pontos do mapa sao ordenados por importancia (contraction
+/// hierarchies) e atalhos sao acrescentados para preservar as distancias.
+/// Cada linha da tabela eh entao calculada pelo algoritmo PHAST: uma busca de
+/// Dijkstra apenas nas rotas que sobem na hierarquia, seguida de uma varredura
+/// linear de todos os pontos, do mais importante ao menos importante, sobre
+/// vetores contiguos de distancias. As origens sao processadas em lotes de
+/// TAM_LOTE, cada ponto guardando as distancias de todas as origens do lote
+/// lado a lado, e os lotes sao distribuidos entre threads.
+/// As rotas sao percorridas nos dois sentidos, como nas demais buscas.
+/// As distancias sao as de calculaCaminho, a menos de arredondamentos na soma
+/// dos comprimentos dos atalhos.
+/// A tabela referencia apenas sua propria copia do grafo: deve ser preparada
+/// de novo se o mapa for alterado.
+class TabelaDistancias
+{
+private:
+  /// Numero de origens calculadas juntas em cada varredura
+  static constexpr unsigned TAM_LOTE = 8;
+
+  /// Posicao de cada ponto na ordem de importancia (0 == mais importante)
+  std::unordered_map<IDPonto, uint32_t> posicao;
+  /// Grafo de subida: para cada posicao p, as rotas e atalhos que levam a
+  /// pontos mais importantes (posicao < p), em
+  /// destino_subida[inicio_subida[p]] ... destino_subida[inicio_subida[p+1]-1]
+  std::vector<uint32_t> inicio_subida;
+  std::vector<uint32_t> destino_subida;
+  std::vector<double> peso_subida;
+  size_t num_atalhos;
+
+  /// Converte ids em posicoes. Retorna false se alguma id nao existir no mapa.
+  bool posicoes(const std::vector<IDPonto>& ids, std::vector<uint32_t>& P) const;
+
+  /// Calcula as linhas das origens O[0] ... O[num-1] (num <= TAM_LOTE),
+  /// gravando em linhas[i*destinos.size()+j] a distancia de O[i] a destinos[j].
+  /// d eh a area de trabalho da varredura.
+  void calculaLote(const uint32_t* O, size_t num,
+                   const std::vector<uint32_t>& destinos,
+                   double* linhas, std::vector<double>& d) const;
+
+  /// Calcula as linhas das origens O[0] ... O[num-1] com num_threads threads
+  void calculaLinhas(const uint32_t* O, size_t num,
+                     const std::vector<uint32_t>& destinos,
+                     double* linhas, unsigned num_threads) const;
+
+public:
+  /// Cria uma tabela vazia
+  TabelaDistancias();
+  /// Cria uma tabela preparada para o mapa
+  explicit TabelaDistancias(const Planejador& Mapa);
+
+  /// Ordena os pontos do mapa e monta o grafo de subida.
+  /// Retorna false (e deixa a tabela vazia) se o mapa estiver vazio.
+  bool preparar(const Planejador& Mapa);
+
+  /// Testa se a tabela estah vazia (nao preparada)
+  bool empty() const
+  {
+    return posicao.empty();
+  }
+
+  /// Numero de atalhos acrescentados em preparar
+  size_t numAtalhos() const
+  {
+    return num_atalhos;
+  }
+
+  /// Calcula as distancias minimas de todas as origens a todos os destinos,
+  /// usando num_threads threads (0 == numero de nucleos disponiveis).
+  /// O parametro D retorna a tabela por linhas: D[i*destinos.size()+j] eh a
+  /// distancia de origens[i] a destinos[j] (<0 se nao existe caminho).
+  /// Retorna false (e D vazio) se a tabela estiver vazia ou algum ponto for invalido.
+  bool calculaTabela(const std::vector<IDPonto>& origens,
+                     const std::vector<IDPonto>& destinos,
+                     std::vector<double>& D,
+                     unsigned num_threads = 0) const;
+
+  /// Calcula a tabela de distancias e a grava no arquivo binario arq,
+  /// um bloco de linhas de cada vez, sem manter a tabela inteira em memoria.
+  /// Formato do arquivo (inteiros e reais na ordem de bytes da maquina):
+  ///   char[8] "PLANTAB1"
+  ///   uint64_t num_origens, num_destinos
+  ///   double distancias[num_origens][num_destinos]  (<0 se nao existe caminho)
+  ///   ids das origens e dos destinos, cada uma terminada por '\0'
+  /// Retorna false se nao conseguir calcular ou gravar a tabela.
+  bool gravarTabela(const std::string& arq,
+                    const std::vector<IDPonto>& origens,
+                    const std::vector<IDPonto>& destinos,
+                    unsigned num_threads = 0) const;
+};
+
+#endif // _PLANEJADOR_TABELA_H_
@@ -6,31 +6,215 @@
 #include <cmath>     // Funções matemáticas (haversine, etc.)
 #include <algorithm> // Funções de busca e ordenação
 #include <utility>   // Manipulação de pares (pair)
+#include <unordered_map> // Indices por ID dos pontos
+#include <thread>    // Buscas de alcance em paralelo
+#include <atomic>    // Distribuicao das origens entre as threads
+#include <mutex>     // Acesso concorrente ao pool de textos
+#include <memory>    // Blocos da arena de textos
+#include <unordered_set> // Verificacao de ids repetidas na leitura
+#include <streambuf> // Leitura de trechos de arquivo mapeados na memoria
+#include <cctype>    // isspace
 
 #include "planejador.h"
+#include "planejador-busca.h"
+#include "planejador-arquivo.h"
 
 using namespace std;
 
+/* *************************
+   * CLASSE POOLTEXTOS     *
+   ************************* */
+
+/// Uma fatia de um pool de textos: arena de blocos de caracteres e tabela
+/// de espalhamento (enderecamento aberto) dos textos jah armazenados.
+/// Cada texto eh guardado como [tamanho (uint32_t)][caracteres]['\0'].
+class PoolTextos::Fatia
+{
+private:
+  static constexpr size_t TAM_BLOCO = 1<<20;
+
+  mutex m;
+  vector< unique_ptr<char[]> > blocos;  // Arena: blocos nunca sao realocados
+  char* livre;                          // Inicio do espaco livre no ultimo bloco
+  size_t resta;                         // Tamanho do espaco livre no ultimo bloco
+  size_t mem_blocos;                    // Soma dos tamanhos dos blocos
+  vector<const char*> tabela;           // Tamanho potencia de 2, nullptr == vazio
+  size_t num_textos;
+
+  static string_view texto(const char* p)
+  {
+    uint32_t n;
+    memcpy(&n, p-sizeof(n), sizeof(n));
+    return string_view(p,n);
+  }
+
+  /// Copia S para a arena
+  const char* copia(string_view S)
+  {
+    uint32_t n = S.size();
+    size_t total = sizeof(n) + n + 1;
+    if (total > resta)
+    {
+      size_t tam = max(TAM_BLOCO, total);
+      blocos.emplace_back(new char[tam]);
+      livre = blocos.back().get();
+      resta = tam;
+      mem_blocos += tam;
+    }
+    memcpy(livre, &n, sizeof(n));
+    char* p = livre + sizeof(n);
+    memcpy(p, S.data(), n);
+    p[n] = '\0';
+    livre += total;
+    resta -= total;
+    return p;
+  }
+
+  /// Dobra o tamanho da tabela
+  void expande()
+  {
+    vector<const char*> nova(2*tabela.size(), nullptr);
+    size_t mascara = nova.size()-1;
+    for (const char* p : tabela)
+    {
+      if (p == nullptr) continue;
+      size_t i = hash<string_view>()(texto(p)) & mascara;
+      while (nova[i] != nullptr) i = (i+1) & mascara;
+      nova[i] = p;
+    }
+    tabela.swap(nova);
+  }
+
+public:
+  Fatia(): m(), blocos(), livre(nullptr), resta(0), mem_blocos(0),
+    tabela(1024, nullptr), num_textos(0) {}
+
+  /// Retorna o endereco de S (cujo espalhamento eh h) na fatia,
+  /// ou nullptr se S nao estiver nela
+  const char* procura(string_view S, size_t h)
+  {
+    lock_guard<mutex> trava(m);
+    size_t mascara = tabela.size()-1;
+    for (size_t i = h & mascara; tabela[i] != nullptr; i = (i+1) & mascara)
+    {
+      if (texto(tabela[i]) == S) return tabela[i];
+    }
+    return nullptr;
+  }
+
+  /// Retorna o endereco de S (cujo espalhamento eh h) na fatia,
+  /// incluindo-o se necessario
+  const char* inclui(string_view S, size_t h)
+  {
+    lock_guard<mutex> trava(m);
+    size_t mascara = tabela.size()-1;
+    size_t i = h & mascara;
+    for (; tabela[i] != nullptr; i = (i+1) & mascara)
+    {
+      if (texto(tabela[i]) == S) return tabela[i];
+    }
+    const char* p = copia(S);
+    tabela[i] = p;
+    // Mantem a ocupacao da tabela abaixo de 75%
+    if (4*(++num_textos) > 3*tabela.size()) expande();
+    return p;
+  }
+
+  /// Memoria ocupada pela fatia (em bytes)
+  size_t memoria()
+  {
+    lock_guard<mutex> trava(m);
+    return mem_blocos + tabela.capacity()*sizeof(const char*);
+  }
+};
+
+/// Cria um pool vazio
+PoolTextos::PoolTextos(): fatias(new Fatia[1<<BITS_FATIAS]) {}
+
+/// Libera todos os textos do pool
+PoolTextos::~PoolTextos() {}
+
+/// Um texto pertence sempre a mesma fatia, escolhida pelos bits mais altos do
+/// seu espalhamento (os mais baixos indexam a tabela da fatia)
+const char* PoolTextos::inclui(string_view S)
+{
+  size_t h = hash<string_view>()(S);
+  return fatias[h >> (8*sizeof(size_t)-BITS_FATIAS)].inclui(S, h);
+}
+
+/// Retorna o endereco de S no pool, ou nullptr se nao estiver nele
+const char* PoolTextos::procura(string_view S) const
+{
+  size_t h = hash<string_view>()(S);
+  return fatias[h >> (8*sizeof(size_t)-BITS_FATIAS)].procura(S, h);
+}
+
+/// Memoria ocupada pelo pool (em bytes)
+size_t PoolTextos::memoria() const
+{
+  size_t total = 0;
+  for (unsigned i = 0; i < (1u<<BITS_FATIAS); ++i) total += fatias[i].memoria();
+  return total;
+}
+
+/* *************************
+   * CLASSE TEXTO          *
+   ************************* */
+
+namespace
+{
+/// O pool de textos, criado no primeiro uso e nunca destruido: Textos em
+/// objetos globais continuam validos ateh o fim do programa
+PoolTextos& pool()
+{
+  static PoolTextos* P = new PoolTextos;
+  return *P;
+}
+}
+
+/// Construtor a partir de uma string: inclui no pool, se necessario
+Texto::Texto(string_view S): p(S.empty() ? nullptr : pool().inclui(S)) {}
+
+/// Construtor a partir de uma string: inclui no pool P, se necessario
+Texto::Texto(string_view S, PoolTextos& P): p(S.empty() ? nullptr : P.inclui(S)) {}
+
+/// Procura S no pool global sem incluir.
+/// Retorna um Texto vazio se S nao estiver no pool.
+Texto Texto::procura(string_view S)
+{
+  Texto T;
+  if (!S.empty()) T.p = pool().procura(S);
+  return T;
+}
+
+/// Memoria ocupada pelo pool de textos (em bytes)
+size_t Texto::memoriaPool()
+{
+  return pool().memoria();
+}
+
 /* *************************
    * CLASSE IDPONTO        *
    ************************* */
 
-/// Atribuicao de string
+/// Atribuicao de string.
+/// Apenas ids validas sao incluidas no pool de textos.
 void IDPonto::set(string&& S)
 {
-  t=move(S);
-  if (!valid()) t.clear();
+  t = (S.size()>=2 && S[0]=='#') ? Texto(S) : Texto();
+  S.clear();
 }
 
 /* *************************
    * CLASSE IDROTA         *
    ************************* */
 
-/// Atribuicao de string
+/// Atribuicao de string.
+/// Apenas ids validas sao incluidas no pool de textos.
 void IDRota::set(string&& S)
 {
-  t=move(S);
-  if (!valid()) t.clear();
+  t = (S.size()>=2 && S[0]=='&') ? Texto(S) : Texto();
+  S.clear();
 }
 
 /* *************************
@@ -43,13 +227,19 @@ double haversine(const Ponto& P1, const Ponto& P2)
   // Tratar logo pontos identicos
   if (P1.id == P2.id) return 0.0;
 
+  return haversine(P1.latitude, P1.longitude, P2.latitude, P2.longitude);
+}
+
+/// Distancia entre 2 coordenadas em graus (formula de haversine)
+double haversine(double lat1, double lon1, double lat2, double lon2)
+{
   static const double MY_PI = 3.14159265358979323846;
   static const double R_EARTH = 6371.0;
   // Conversao para radianos
-  double lat1 = MY_PI*P1.latitude/180.0;
-  double lat2 = MY_PI*P2.latitude/180.0;
-  double lon1 = MY_PI*P1.longitude/180.0;
-  double lon2 = MY_PI*P2.longitude/180.0;
+  lat1 = MY_PI*lat1/180.0;
+  lat2 = MY_PI*lat2/180.0;
+  lon1 = MY_PI*lon1/180.0;
+  lon2 = MY_PI*lon2/180.0;
 
   double cosseno = sin(lat1)*sin(lat2) + cos(lat1)*cos(lat2)*cos(lon1-lon2);
   // Para evitar eventuais erros na funcao acos por imprecisao numerica
@@ -64,11 +254,32 @@ double haversine(const Ponto& P1, const Ponto& P2)
    * CLASSE PLANEJADOR     *
    ************************* */
 
+/// Cabecalhos dos arquivos do mapa
+static const string CABECALHO_PONTOS = "ID;Nome;Latitude;Longitude";
+static const string CABECALHO_ROTAS = "ID;Nome;Extremidade 1;Extremidade 2;Comprimento";
+
 /// Torna o mapa vazio
 void Planejador::clear()
 {
   pontos.clear();
   rotas.clear();
+  grafo.clear();
+}
+
+/// Monta o grafo a partir das listas de pontos e de rotas
+void Planejador::indexarGrafo()
+{
+  grafo.clear();
+  grafo.reserve(pontos.size());
+  for (const Ponto& P : pontos)
+  {
+    grafo[P.id] = {P.latitude, P.longitude, {}};
+  }
+  for (const Rota& R : rotas)
+  {
+    grafo[R.extremidade[0]].rotas.push_back({R.id, R.extremidade[1], R.comprimento});
+    grafo[R.extremidade[1]].rotas.push_back({R.id, R.extremidade[0], R.comprimento});
+  }
 }
 
 /// Retorna um Ponto do mapa, passando a id como parametro.
@@ -117,6 +328,79 @@ void Planejador::imprimirRotas() const
   }
 }
 
+/// Leh um ponto do arquivo de pontos, a partir da posicao atual de arq.
+/// Em caso de erro, lanca o codigo do erro.
+static void lePonto(istream& arq, Ponto& P, string& prov)
+{
+  // Leh a ID
+  getline(arq,prov,';');
+  if (arq.fail()) throw 3;
+  P.id.set(move(prov));
+  if (!P.valid()) throw 4;
+
+  // Leh o nome
+  getline(arq,prov,';');
+  if (arq.fail() || prov.size()<2) throw 5;
+  P.nome = Texto(prov);
+
+  // Leh a latitude
+  arq >> P.latitude;
+  if (arq.fail()) throw 6;
+  arq.ignore(1,';');
+
+  // Leh a longitude
+  arq >> P.longitude;
+  if (arq.fail()) throw 7;
+  arq >> ws;
+}
+
+/// Leh uma rota do arquivo de rotas, a partir da posicao atual de arq.
+/// Se idsP nao for nulo, verifica se as extremidades pertencem a idsP.
+/// Em caso de erro, lanca o codigo do erro.
+static void leRota(istream& arq, Rota& R, string& prov,
+                   const unordered_set<IDPonto>* idsP)
+{
+  // Leh a ID
+  getline(arq,prov,';');
+  if (arq.fail()) throw 3;
+  R.id.set(move(prov));
+  if (!R.valid()) throw 4;
+
+  // Leh o nome
+  getline(arq,prov,';');
+  if (arq.fail() || prov.size()<2) throw 4;
+  R.nome = Texto(prov);
+
+  // Leh a id da extremidade[0]
+  getline(arq,prov,';');
+  if (arq.fail()) throw 6;
+  R.extremidade[0].set(move(prov));
+  if (!R.extremidade[0].valid()) throw 7;
+
+  // Verifica se a Id corresponde a um ponto entre os pontos lidos (idsP)
+  // Caso ponto não exista, lança uma exceção (throw 8)
+  if (idsP != nullptr && idsP->count(R.extremidade[0]) == 0) {
+      throw 8; // Lança a exceção 8 se o ponto com extremidade[0] não for encontrado
+  }
+
+  // Leh a id da extremidade[1]
+  getline(arq,prov,';');
+  if (arq.fail()) throw 9;
+  R.extremidade[1].set(move(prov));
+  if (!R.extremidade[1].valid()) throw 10;
+
+  // Verifica se a Id corresponde a um ponto entre os pontos lidos (idsP)
+  // Caso ponto não exista, lança uma exceção (throw 11)
+  if (idsP != nullptr && idsP->count(R.extremidade[1]) == 0) {
+      throw 11; // Lança a exceção 11 se o ponto com extremidade[1] não for encontrado
+  }
+
+  // Leh o comprimento
+  arq >> R.comprimento;
+  if (arq.fail()) throw 12;
+  arq >> ws;
+}
+
 /// Leh um mapa dos arquivos arq_pontos e arq_rotas.
 /// Caso nao consiga ler dos arquivos, deixa o mapa inalterado e retorna false.
 /// Retorna true em caso de leitura bem sucedida
@@ -126,9 +410,9 @@ bool Planejador::ler(const std::string& arq_pontos,
   // Listas temporarias para armazenamento dos dados lidos
   list<Ponto> listP;
   list<Rota> listR;
-  // Variaveis auxiliares para buscas nas listas
-  list<Ponto>::iterator itr_ponto;
-  list<Rota>::iterator itr_rota;
+  // Ids jah lidas, para as verificacoes de ids repetidas ou inexistentes
+  unordered_set<IDPonto> idsP;
+  unordered_set<IDRota> idsR;
   // Variaveis auxiliares para leitura de dados
   Ponto P;
   Rota R;
@@ -144,41 +428,18 @@ bool Planejador::ler(const std::string& arq_pontos,
     // Leh o cabecalho
     getline(arq,prov);
     if (arq.fail() ||
-        prov != "ID;Nome;Latitude;Longitude") throw 2;
+        prov != CABECALHO_PONTOS) throw 2;
 
     // Leh os pontos
     do
     {
-      // Leh a ID
-      getline(arq,prov,';');
-      if (arq.fail()) throw 3;
-      P.id.set(move(prov));
-      if (!P.valid()) throw 4;
-
-      // Leh o nome
-      getline(arq,prov,';');
-      if (arq.fail() || prov.size()<2) throw 5;
-      P.nome = move(prov);
-
-      // Leh a latitude
-      arq >> P.latitude;
-      if (arq.fail()) throw 6;
-      arq.ignore(1,';');
-
-      // Leh a longitude
-      arq >> P.longitude;
-      if (arq.fail()) throw 7;
-      arq >> ws;
-
-      // Verifica se já existe ponto com a mesma ID no contêiner de pontos lidos (listP)
-      // Caso exista, lança uma exceção (throw 8)
-      auto it = find_if(listP.begin(), listP.end(), [&P](const Ponto& ponto) {
-          return ponto.id == P.id; // Verifica se o ID do ponto atual é igual ao ID do novo ponto
-      });
+      lePonto(arq,P,prov);
 
-      if (it != listP.end()) {
+      // Verifica se já existe ponto com a mesma ID entre os pontos lidos (idsP)
+      // Caso exista, lança uma exceção (throw 8)
+      if (!idsP.insert(P.id).second) {
           throw 8; // Lança a exceção 8 se o ID já existe
-}
+      }
 
       // Inclui o ponto na lista de pontos
       listP.push_back(move(P));
@@ -205,69 +466,18 @@ bool Planejador::ler(const std::string& arq_pontos,
     // Leh o cabecalho
     getline(arq,prov);
     if (arq.fail() ||
-        prov != "ID;Nome;Extremidade 1;Extremidade 2;Comprimento") throw 2;
+        prov != CABECALHO_ROTAS) throw 2;
 
     // Leh as rotas
     do
     {
-      // Leh a ID
-      getline(arq,prov,';');
-      if (arq.fail()) throw 3;
-      R.id.set(move(prov));
-      if (!R.valid()) throw 4;
-
-      // Leh o nome
-      getline(arq,prov,';');
-      if (arq.fail() || prov.size()<2) throw 4;
-      R.nome = move(prov);
-
-      // Leh a id da extremidade[0]
-      getline(arq,prov,';');
-      if (arq.fail()) throw 6;
-      R.extremidade[0].set(move(prov));
-      if (!R.extremidade[0].valid()) throw 7;
-
-      // Verifica se a Id corresponde a um ponto no contêiner de pontos lidos (listP)
-      // Caso ponto não exista, lança uma exceção (throw 8)
-      auto it_ext0 = find_if(listP.begin(), listP.end(), [&R](const Ponto& ponto) {
-          return ponto.id == R.extremidade[0];
-      });
-
-      if (it_ext0 == listP.end()) {
-          throw 8; // Lança a exceção 8 se o ponto com extremidade[0] não for encontrado
-      }
-
-      // Leh a id da extremidade[1]
-      getline(arq,prov,';');
-      if (arq.fail()) throw 9;
-      R.extremidade[1].set(move(prov));
-      if (!R.extremidade[1].valid()) throw 10;
+      leRota(arq,R,prov,&idsP);
 
-      // Verifica se a Id corresponde a um ponto no contêiner de pontos lidos (listP)
-      // Caso ponto não exista, lança uma exceção (throw 11)
-      auto it_ext1 = find_if(listP.begin(), listP.end(), [&R](const Ponto& ponto) {
-          return ponto.id == R.extremidade[1];
-      });
-
-      if (it_ext1 == listP.end()) {
-          throw 11; // Lança a exceção 11 se o ponto com extremidade[1] não for encontrado
-      }
-
-
-      // Leh o comprimento
-      arq >> R.comprimento;
-      if (arq.fail()) throw 12;
-      arq >> ws;
-
-      // Verifica se já existe rota com a mesma ID no contêiner de rotas lidas (listR)
+      // Verifica se já existe rota com a mesma ID entre as rotas lidas (idsR)
       // Caso exista, lança uma exceção (throw 13)
-      auto it_rota = find_if(listR.begin(), listR.end(), [&R](const Rota& rota) {
-          return rota.id == R.id;
-      });
-
-if (it_rota != listR.end()) {
-    throw 13; // Lança a exceção 13 se já existir uma rota com o mesmo ID
-}
+      if (!idsR.insert(R.id).second) {
+          throw 13; // Lança a exceção 13 se já existir uma rota com o mesmo ID
+      }
 
       // Inclui a rota na lista de rotas
       listR.push_back(move(R));
@@ -288,6 +498,219 @@ if (it_rota != listR.end()) {
   // Move as listas de pontos e rotas para o planejador.
   pontos = move(listP);
   rotas = move(listR);
+  indexarGrafo();
+
+  return true;
+}
+
+/// *******************************************************************************
+/// Leitura paralela do mapa
+/// *******************************************************************************
+
+/// streambuf de leitura sobre um trecho de memoria, sem copia
+class TrechoBuf: public streambuf
+{
+public:
+  TrechoBuf(const char* inicio, const char* fim)
+  {
+    setg(const_cast<char*>(inicio), const_cast<char*>(inicio), const_cast<char*>(fim));
+  }
+};
+
+/// Confere o cabecalho de dados e divide o restante em ate num_trechos trechos
+/// que comecam no inicio de um registro: logo apos uma quebra de linha e os
+/// espacos que a leitura serial (arq >> ws) descartaria.
+/// Retorna em inicios a posicao de inicio de cada trecho, seguida do fim dos dados.
+/// Retorna false se o cabecalho for invalido ou nao houver registros.
+static bool divideTrechos(string_view dados, const string& cabecalho,
+                          size_t num_trechos, vector<size_t>& inicios)
+{
+  inicios.clear();
+  size_t pos = dados.find('\n');
+  if (pos == string_view::npos) return false;
+  size_t tam_cab = pos;
+#if defined(_WIN32)
+  // A leitura serial, em modo texto, nao ve o '\r' das quebras de linha
+  if (tam_cab > 0 && dados[tam_cab-1] == '\r') --tam_cab;
+#endif
+  if (dados.substr(0, tam_cab) != cabecalho) return false;
+  size_t inicio = pos+1;
+  size_t fim = dados.size();
+  if (inicio >= fim) return false;
+
+  inicios.push_back(inicio);
+  for (size_t k=1; k<num_trechos; ++k)
+  {
+    size_t p = dados.find('\n', inicio + k*(fim-inicio)/num_trechos);
+    if (p == string_view::npos) break;
+    for (++p; p<fim && isspace(static_cast<unsigned char>(dados[p])); ++p) {}
+    if (p < fim && p > inicios.back()) inicios.push_back(p);
+  }
+  inicios.push_back(fim);
+  return true;
+}
+
+/// Executa tarefa(0), ..., tarefa(num_tarefas-1) distribuidas entre num_threads threads
+/// (0 == numero de nucleos disponiveis)
+void executaEmParalelo(size_t num_tarefas, unsigned num_threads,
+                       const function<void(size_t)>& tarefa)
+{
+  if (num_tarefas == 0) return;
+  if (num_threads == 0) num_threads = thread::hardware_concurrency();
+  num_threads = max(1u, min<unsigned>(num_threads, num_tarefas));
+
+  // Cada thread pega a proxima tarefa ainda nao executada
+  atomic<size_t> proxima(0);
+  auto trabalho = [&]() {
+    for (size_t i = proxima++; i < num_tarefas; i = proxima++) tarefa(i);
+  };
+
+  vector<thread> threads;
+  for (unsigned k = 1; k < num_threads; ++k) threads.emplace_back(trabalho);
+  trabalho();
+  for (thread& T : threads) T.join();
+}
+
+/// Leh um mapa dos arquivos arq_pontos e arq_rotas em paralelo.
+bool Planejador::lerParalelo(const std::string& arq_pontos,
+                             const std::string& arq_rotas,
+                             unsigned num_threads)
+{
+  if (num_threads == 0) num_threads = thread::hardware_concurrency();
+  num_threads = max(1u, num_threads);
+
+  // Mapeia os dois arquivos em memoria: os trechos sao lidos diretamente
+  // das paginas do arquivo, sem copia para um buffer
+  ArquivoMapeado arqP, arqR;
+  bool okP = arqP.abrir(arq_pontos);
+  bool okR = arqR.abrir(arq_rotas);
+  const string_view dadosP = arqP.conteudo(), dadosR = arqR.conteudo();
+
+  // Divide cada arquivo em trechos. Mais trechos que threads equilibra a carga,
+  // mas trechos muito pequenos nao compensam.
+  static const size_t TAM_MIN_TRECHO = 1<<20;
+  vector<size_t> iniP, iniR;
+  if (!okP || !okR ||
+      !divideTrechos(dadosP, CABECALHO_PONTOS,
+                     min<size_t>(4*num_threads, dadosP.size()/TAM_MIN_TRECHO+1), iniP) ||
+      !divideTrechos(dadosR, CABECALHO_ROTAS,
+                     min<size_t>(4*num_threads, dadosR.size()/TAM_MIN_TRECHO+1), iniR))
+  {
+    // A leitura serial reporta o erro exatamente
+    arqP.fechar();
+    arqR.fechar();
+    return ler(arq_pontos, arq_rotas);
+  }
+  size_t nP = iniP.size()-1, nR = iniR.size()-1;
+
+  // Leh os trechos dos dois arquivos ao mesmo tempo.
+  // A verificacao das ids e das extremidades das rotas eh feita depois: as ids
+  // sao divididas em nF fatias pelo valor de espalhamento, e as ids de cada
+  // trecho jah sao separadas em baldes, um por fatia.
+  size_t nF = num_threads;
+  vector< list<Ponto> > trechosP(nP);
+  vector< list<Rota> > trechosR(nR);
+  vector< vector< vector<IDPonto> > > baldesP(nP, vector< vector<IDPonto> >(nF));
+  vector< vector< vector<IDRota> > > baldesR(nR, vector< vector<IDRota> >(nF));
+  atomic<bool> ok(true);
+  executaEmParalelo(nP+nR, num_threads, [&](size_t k) {
+    bool eh_ponto = (k < nP);
+    const string_view dados = (eh_ponto ? dadosP : dadosR);
+    size_t i = (eh_ponto ? k : k-nP);
+    const vector<size_t>& ini = (eh_ponto ? iniP : iniR);
+
+    TrechoBuf buf(dados.data()+ini[i], dados.data()+ini[i+1]);
+    istream arq(&buf);
+    string prov;
+    try
+    {
+      do
+      {
+        if (eh_ponto)
+        {
+          Ponto P;
+          lePonto(arq,P,prov);
+          baldesP[i][hash<IDPonto>()(P.id) % nF].push_back(P.id);
+          trechosP[i].push_back(move(P));
+        }
+        else
+        {
+          Rota R;
+          leRota(arq,R,prov,nullptr);
+          baldesR[i][hash<IDRota>()(R.id) % nF].push_back(R.id);
+          trechosR[i].push_back(move(R));
+        }
+      }
+      while (!arq.eof() && ok);
+    }
+    catch (int)
+    {
+      ok = false;
+    }
+  });
+  // Os textos jah foram copiados para o pool: os arquivos nao sao mais usados
+  arqP.fechar();
+  arqR.fechar();
+  if (!ok)
+  {
+    trechosP.clear();
+    trechosR.clear();
+    baldesP.clear();
+    baldesR.clear();
+    return ler(arq_pontos, arq_rotas);
+  }
+
+  // Verifica ids repetidas e extremidades inexistentes. Cada fatia eh
+  // verificada por uma thread, que percorre apenas os seus baldes.
+  vector< unordered_set<IDPonto> > idsP(nF);
+  vector< unordered_set<IDRota> > idsR(nF);
+  executaEmParalelo(2*nF, num_threads, [&](size_t k) {
+    size_t f = k % nF;
+    if (k < nF)
+    {
+      for (const auto& B : baldesP)
+        for (const IDPonto& Id : B[f])
+          if (!idsP[f].insert(Id).second) ok = false;
+    }
+    else
+    {
+      for (const auto& B : baldesR)
+        for (const IDRota& Id : B[f])
+          if (!idsR[f].insert(Id).second) ok = false;
+    }
+  });
+  baldesP.clear();
+  baldesR.clear();
+  if (ok)
+  {
+    executaEmParalelo(nR, num_threads, [&](size_t i) {
+      for (const Rota& R : trechosR[i])
+      {
+        for (const IDPonto& E : R.extremidade)
+        {
+          if (idsP[hash<IDPonto>()(E) % nF].count(E) == 0) ok = false;
+        }
+      }
+    });
+  }
+  if (!ok)
+  {
+    trechosP.clear();
+    trechosR.clear();
+    idsP.clear();
+    idsR.clear();
+    return ler(arq_pontos, arq_rotas);
+  }
+
+  // Junta os trechos na ordem dos arquivos
+  list<Ponto> listP;
+  list<Rota> listR;
+  for (auto& L : trechosP) listP.splice(listP.end(), L);
+  for (auto& L : trechosR) listR.splice(listR.end(), L);
+
+  pontos = move(listP);
+  rotas = move(listR);
+  indexarGrafo();
 
   return true;
 }
@@ -296,22 +719,39 @@ if (it_rota != listR.end()) {
 /// Calcula o caminho entre a origem e o destino do planejador usando o algoritmo A*
 /// *******************************************************************************
 
-/// Noh: os elementos dos conjuntos de busca do algoritmo A*
-struct Noh {
-    IDPonto id_pt;    // Identificador do ponto
-    IDRota id_rt;     // Identificador da rota até o ponto
-    double g;         // Custo acumulado do caminho
-    double h;         // Heurística (estimativa do custo restante)
-    
-    // Função custo total
-    double f() const { 
-        return g + h; 
+/// O grafo do Planejador visto pelo algoritmo A* (ver planejador-busca.h)
+struct GrafoMemoria
+{
+  using No = IDPonto;
+  using Rota = IDRota;
+
+  const unordered_map<IDPonto, Planejador::NohMapa>& grafo;
+
+  void coordenadas(const No& n, double& lat, double& lon) const
+  {
+    const Planejador::NohMapa& N = grafo.at(n);
+    lat = N.latitude;
+    lon = N.longitude;
+  }
+
+  template<class F>
+  void paraCadaRota(const No& n, F f) const
+  {
+    for (const Planejador::Vizinho& V : grafo.at(n).rotas)
+    {
+      const Planejador::NohMapa& S = grafo.at(V.id_pt);
+      f(V.id_rt, V.id_pt, V.comprimento, S.latitude, S.longitude);
     }
+  }
 
-    // Construtor padrão
-    Noh(const IDPonto& idP = IDPonto(), const IDRota& idR = IDRota(),
-        double custoG = 0.0, double custoH = 0.0)
-        : id_pt(idP), id_rt(idR), g(custoG), h(custoH) {}
+  IDPonto idPonto(const No& n) const
+  {
+    return n;
+  }
+  IDRota idRota(const Rota& r) const
+  {
+    return r;
+  }
 };
 
 /// Calcula o caminho entre a origem e o destino do planejador usando o algoritmo A*
@@ -333,108 +773,327 @@ double Planejador::calculaCaminho(const IDPonto& id_origem,
     try {
         // Verificações iniciais
         if (empty()) throw 1;
+        if (grafo.count(id_origem) == 0) throw 4;
+        if (grafo.count(id_destino) == 0) throw 5;
 
-        Ponto pt_orig = getPonto(id_origem);
-        if (!pt_orig.valid()) throw 4;
-
-        Ponto pt_dest = getPonto(id_destino);
-        if (!pt_dest.valid()) throw 5;
-
-        // Contêineres do algoritmo
-        list<Noh> Aberto, Fechado;
-
-        // Noh inicial
-        Noh atual(id_origem, IDRota(), 0.0, haversine(pt_orig, pt_dest));
-        Aberto.push_back(atual);
-
-        // Laço principal
-        while (!Aberto.empty()) {
-            // Encontra o nó com menor custo total f()
-            Aberto.sort([](const Noh& a, const Noh& b) {
-                return a.f() < b.f();
-            });
-
-            atual = Aberto.front();
-            Aberto.pop_front();
-
-            // Verifica se o destino foi alcançado
-            if (atual.id_pt == id_destino) {
-                // Reconstrói o caminho a partir do Fechado
-                C.clear();
-                double comprimento_total = atual.g;
-
-                while (atual.id_rt != IDRota()) {
-                    C.push_front({atual.id_rt, atual.id_pt});
-                    Rota rota_ant = getRota(atual.id_rt);
-
-                    // Identifica o antecessor
-                    atual.id_pt = (rota_ant.extremidade[0] == atual.id_pt)
-                                      ? rota_ant.extremidade[1]
-                                      : rota_ant.extremidade[0];
-                    
-                    auto it = find_if(Fechado.begin(), Fechado.end(),
-                                      [&atual](const Noh& n) {
-                                          return n.id_pt == atual.id_pt;
-                                      });
-                    if (it != Fechado.end())
-                        atual = *it;
-                }
-
-                // Calcula nós em Aberto e Fechado
-                NA = Aberto.size();
-                NF = Fechado.size()+1;
-
-                return comprimento_total;
-            }
-
-            // Move o nó atual para Fechado
-            Fechado.push_back(atual);
-
-            // Gera sucessores
-            for (const Rota& rota : rotas) {
-                if (rota.extremidade[0] != atual.id_pt && rota.extremidade[1] != atual.id_pt)
-                    continue;
-
-                // Define a extremidade do sucessor
-                IDPonto id_suc = (rota.extremidade[0] == atual.id_pt)
-                                     ? rota.extremidade[1]
-                                     : rota.extremidade[0];
-
-                if (find_if(Fechado.begin(), Fechado.end(),
-                            [&id_suc](const Noh& n) {
-                                return n.id_pt == id_suc;
-                            }) != Fechado.end()) {
-                    continue; // Ignora nós já processados
-                }
-
-                Ponto pt_suc = getPonto(id_suc);
-                double custo_g = atual.g + rota.comprimento;
-                double custo_h = haversine(pt_suc, pt_dest);
-
-                // Verifica se o nó já está em Aberto
-                auto it = find_if(Aberto.begin(), Aberto.end(),
-                                  [&id_suc](const Noh& n) {
-                                      return n.id_pt == id_suc;
-                                  });
-
-                if (it != Aberto.end()) {
-                    if (custo_g + custo_h < it->f()) {
-                        Aberto.erase(it);
-                        Aberto.emplace_back(id_suc, rota.id, custo_g, custo_h);
-                    }
-                } else {
-                    Aberto.emplace_back(id_suc, rota.id, custo_g, custo_h);
-                }
-            }
-        }
+        GrafoMemoria G{grafo};
+        return buscaAEstrela(G, id_origem, id_destino, C, NA, NF);
+    } catch (int i) {
+        cerr << "Erro " << i << " no calculo do caminho\n";
+        NA = NF = -1;
+        return -1.0;
+    }
+}
+
+/// *******************************************************************************
+/// Calcula os pontos alcancaveis a partir de uma origem (algoritmo de Dijkstra limitado)
+/// *******************************************************************************
+
+/// Extrai de um conjunto de pontos alcancados o caminho ateh o destino.
+/// Retorna false (e C vazio) se o destino nao pertence a A.
+bool extraiCaminho(const Alcancaveis& A, const IDPonto& id_destino, Caminho& C)
+{
+    C.clear();
+
+    // Indice dos pontos alcancados
+    unordered_map<IDPonto, const Alcance*> indice;
+    indice.reserve(A.size());
+    for (const Alcance& a : A) indice.emplace(a.id_pt, &a);
+
+    auto it = indice.find(id_destino);
+    if (it == indice.end()) return false;
+
+    // Sobe pela arvore de caminhos ateh a origem
+    const Alcance* atual = it->second;
+    C.push_front({atual->id_rt, atual->id_pt});
+    while (atual->id_rt != IDRota()) {
+        atual = indice.at(atual->id_ant);
+        C.push_front({atual->id_rt, atual->id_pt});
+    }
+    return true;
+}
+
+/// Calcula todos os pontos alcancaveis a partir da origem por caminhos de
+/// comprimento <= dist_max, usando o algoritmo de Dijkstra limitado.
+/// Retorna o numero de pontos alcancados (<0 se parametros invalidos).
+/// O parametro A retorna os pontos alcancados com suas distancias e a arvore
+/// de caminhos utilizada (vazio se parametros invalidos).
+int Planejador::calculaAlcance(const IDPonto& id_origem, double dist_max,
+                               Alcancaveis& A) const
+{
+    A.clear();
+
+    try {
+        // Verificações iniciais
+        if (empty()) throw 1;
+        if (!(dist_max >= 0.0)) throw 2; // Tambem rejeita NAN
+
+        // A busca limitada eh uma busca por origem expandida ateh dist_max,
+        // que nao abre os pontos alem de dist_max
+        BuscaOrigem B(*this, id_origem, dist_max);
+        if (!B.valid()) throw 3;
+        B.expandir(dist_max);
+        B.alcancados(dist_max, A);
+
+        return A.size();
+    } catch (int i) {
+        cerr << "Erro " << i << " no calculo do alcance\n";
+        return -1;
+    }
+}
+
+/// Calcula o alcance de varias origens em paralelo.
+/// Retorna o numero de origens validas.
+int Planejador::calculaAlcances(const vector<IDPonto>& origens, double dist_max,
+                                vector<Alcancaveis>& A,
+                                unsigned num_threads) const
+{
+    A.assign(origens.size(), Alcancaveis());
+
+    atomic<int> validas(0);
+    executaEmParalelo(origens.size(), num_threads, [&](size_t i) {
+        if (calculaAlcance(origens[i], dist_max, A[i]) >= 0) ++validas;
+    });
+
+    return validas;
+}
+
+/* *************************
+   * CLASSE BUSCAORIGEM    *
+   ************************* */
+
+/// Inicia uma busca a partir de id_origem no mapa.
+/// Se a origem nao existir no mapa, a busca eh invalida.
+/// Os pontos mais distantes que dist_max nao entram na fronteira.
+BuscaOrigem::BuscaOrigem(const Planejador& Mapa, const IDPonto& id_origem,
+                         double dist_max):
+  G(&Mapa), origem(id_origem), rotulos(), fechado(), indice(), fechados(),
+  Aberto(), num_abertos(0), limite(dist_max)
+{
+  if (G->grafo.count(origem) == 0) return;
+
+  indice.emplace(origem, 0);
+  rotulos.push_back({origem, IDRota(), IDPonto(), 0.0});
+  fechado.push_back(false);
+  Aberto.emplace_back(0.0, 0);
+  num_abertos = 1;
+}
+
+/// Descarta as entradas obsoletas do topo da fronteira:
+/// rotulo jah fechado ou cuja distancia jah foi melhorada
+void BuscaOrigem::limpaTopo()
+{
+  while (!Aberto.empty())
+  {
+    const auto& topo = Aberto.front();
+    if (!fechado[topo.second] && topo.first <= rotulos[topo.second].dist) return;
+    pop_heap(Aberto.begin(), Aberto.end(), greater< pair<double,size_t> >());
+    Aberto.pop_back();
+  }
+}
+
+/// Fecha o rotulo do topo da fronteira e relaxa suas rotas.
+/// Deve ser chamada apos limpaTopo, com a fronteira nao vazia.
+/// Retorna o indice do rotulo fechado.
+size_t BuscaOrigem::fechaProximo()
+{
+  pop_heap(Aberto.begin(), Aberto.end(), greater< pair<double,size_t> >());
+  size_t i = Aberto.back().second;
+  Aberto.pop_back();
+
+  fechado[i] = true;
+  fechados.push_back(i);
+  --num_abertos;
+
+  // Copias: rotulos pode ser realocado ao incluir sucessores
+  const IDPonto id_pt = rotulos[i].id_pt;
+  const double g = rotulos[i].dist;
+
+  for (const Planejador::Vizinho& V : G->grafo.at(id_pt).rotas)
+  {
+    double custo_g = g + V.comprimento;
+    // Fora do limite: o ponto nao eh aberto (nem recebe rotulo)
+    if (custo_g > limite) continue;
+    auto suc = indice.try_emplace(V.id_pt, rotulos.size());
+    size_t j = suc.first->second;
+    if (suc.second)
+    {
+      // Ponto descoberto agora
+      rotulos.push_back({V.id_pt, V.id_rt, id_pt, custo_g});
+      fechado.push_back(false);
+      ++num_abertos;
+    }
+    else if (!fechado[j] && custo_g < rotulos[j].dist)
+    {
+      // Caminho melhor para um ponto em aberto
+      rotulos[j] = {V.id_pt, V.id_rt, id_pt, custo_g};
+    }
+    else continue;
+
+    Aberto.emplace_back(custo_g, j);
+    push_heap(Aberto.begin(), Aberto.end(), greater< pair<double,size_t> >());
+  }
+  return i;
+}
+
+/// Expande a busca ateh fechar id_destino ou esgotar a fronteira.
+/// Retorna true se o destino estah fechado.
+bool BuscaOrigem::expandir(const IDPonto& id_destino)
+{
+  auto it = indice.find(id_destino);
+  if (it != indice.end() && fechado[it->second]) return true;
+
+  for (limpaTopo(); !Aberto.empty(); limpaTopo())
+  {
+    if (rotulos[fechaProximo()].id_pt == id_destino) return true;
+  }
+  return false;
+}
+
+/// Expande a busca ateh fechar todos os pontos com distancia <= dist_max.
+void BuscaOrigem::expandir(double dist_max)
+{
+  for (limpaTopo(); !Aberto.empty() && Aberto.front().first <= dist_max; limpaTopo())
+  {
+    fechaProximo();
+  }
+}
+
+/// Calcula o caminho mais curto da origem ateh o destino, retomando a busca
+/// apenas se o destino ainda nao foi fechado.
+double BuscaOrigem::calculaCaminho(const IDPonto& id_destino,
+                                   Caminho& C, int& NA, int& NF)
+{
+    // Zera o caminho resultado
+    C.clear();
+
+    try {
+        // Verificações iniciais
+        if (G->empty()) throw 1;
+        if (!valid()) throw 4;
+        if (G->grafo.count(id_destino) == 0) throw 5;
+
+        bool achou = expandir(id_destino);
+        NA = numAbertos();
+        NF = numFechados();
 
         // Não há solução
-        NA = Aberto.size();
-        NF = Fechado.size();
-        return -1.0;
+        if (!achou) return -1.0;
+
+        // Reconstrói o caminho subindo pela arvore de rotulos
+        const Alcance* atual = &rotulos[indice.at(id_destino)];
+        double comprimento_total = atual->dist;
+        C.push_front({atual->id_rt, atual->id_pt});
+        while (atual->id_rt != IDRota()) {
+            atual = &rotulos[indice.at(atual->id_ant)];
+            C.push_front({atual->id_rt, atual->id_pt});
+        }
+        return comprimento_total;
     } catch (int i) {
         cerr << "Erro " << i << " no calculo do caminho\n";
         NA = NF = -1;
         return -1.0;
     }
 }
+
+/// Retorna em A os pontos jah fechados com distancia <= dist_max,
+/// em ordem crescente de distancia.
+void BuscaOrigem::alcancados(double dist_max, Alcancaveis& A) const
+{
+  A.clear();
+  for (size_t i : fechados)
+  {
+    if (rotulos[i].dist > dist_max) break;
+    A.push_back(rotulos[i]);
+  }
+}
+
+/// Estimativa da memoria ocupada pela busca (em bytes)
+size_t BuscaOrigem::memoria() const
+{
+  // Cada elemento do unordered_map ocupa um noh com o par e um ponteiro
+  return rotulos.capacity()*sizeof(Alcance)
+       + fechado.capacity()/8
+       + indice.size()*(sizeof(pair<const IDPonto,size_t>) + sizeof(void*))
+       + indice.bucket_count()*sizeof(void*)
+       + fechados.capacity()*sizeof(size_t)
+       + Aberto.capacity()*sizeof(pair<double,size_t>);
+}
+
+/* *************************
+   * CLASSE CACHEBUSCAS    *
+   ************************* */
+
+/// Descarta as buscas menos recentes ateh respeitar os limites
+void CacheBuscas::aplicaLimites()
+{
+  size_t total = memoria();
+  while (buscas.size() > 1 &&
+         (buscas.size() > max_origens || total > max_memoria))
+  {
+    total -= buscas.back().memoria();
+    indice.erase(buscas.back().getOrigem());
+    buscas.pop_back();
+  }
+}
+
+/// Altera os limites, descartando buscas se necessario
+void CacheBuscas::setLimites(size_t MaxOrigens, size_t MaxMemoria)
+{
+  max_origens = MaxOrigens;
+  max_memoria = MaxMemoria;
+  aplicaLimites();
+}
+
+/// Descarta todas as buscas
+void CacheBuscas::clear()
+{
+  indice.clear();
+  buscas.clear();
+  invalida.clear();
+}
+
+/// Memoria total ocupada pelas buscas (em bytes)
+size_t CacheBuscas::memoria() const
+{
+  size_t total = 0;
+  for (const BuscaOrigem& B : buscas) total += B.memoria();
+  return total;
+}
+
+/// Retorna a busca da origem, criando-a se necessario,
+/// e a torna a mais recente. Uma busca invalida nao eh guardada
+/// e nao descarta nenhuma das buscas guardadas.
+BuscaOrigem& CacheBuscas::getBusca(const IDPonto& id_origem)
+{
+  auto it = indice.find(id_origem);
+  if (it != indice.end())
+  {
+    buscas.splice(buscas.begin(), buscas, it->second);
+  }
+  else
+  {
+    buscas.emplace_front(*G, id_origem);
+    if (!buscas.front().valid())
+    {
+      invalida.clear();
+      invalida.splice(invalida.begin(), buscas, buscas.begin());
+      return invalida.front();
+    }
+    indice.emplace(id_origem, buscas.begin());
+    aplicaLimites();
+  }
+  return buscas.front();
+}
+
+/// Calcula o caminho mais curto entre origem e destino reaproveitando a busca
+/// guardada para a origem.
+double CacheBuscas::calculaCaminho(const IDPonto& id_origem,
+                                   const IDPonto& id_destino,
+                                   Caminho& C, int& NA, int& NF)
+{
+  double compr = getBusca(id_origem).calculaCaminho(id_destino, C, NA, NF);
+  // A busca pode ter crescido ao ser retomada
+  aplicaLimites();
+  return compr;
+}
@@ -2,8 +2,130 @@
 #define _PLANEJADOR_H_
 
 #include <string>
+#include <string_view>
 #include <list>
+#include <vector>
+#include <unordered_map>
+#include <functional>
 #include <ostream>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <cstring>
+
+/* *************************
+   * CLASSE POOLTEXTOS     *
+   ************************* */
+
+/// Conjunto de textos armazenados uma unica vez em blocos contiguos (arena),
+/// dividido em fatias independentes para que varias threads possam incluir
+/// textos ao mesmo tempo (ex.: Planejador::lerParalelo).
+/// Os Textos de um pool sao validos enquanto o pool existir.
+class PoolTextos
+{
+private:
+  static constexpr unsigned BITS_FATIAS = 4;
+  class Fatia;
+  std::unique_ptr<Fatia[]> fatias;
+
+public:
+  /// Cria um pool vazio
+  PoolTextos();
+  /// Libera todos os textos do pool
+  ~PoolTextos();
+  PoolTextos(const PoolTextos&) = delete;
+  PoolTextos& operator=(const PoolTextos&) = delete;
+
+  /// Retorna o endereco de S no pool, incluindo-o se necessario
+  const char* inclui(std::string_view S);
+  /// Retorna o endereco de S no pool, ou nullptr se nao estiver nele
+  const char* procura(std::string_view S) const;
+  /// Memoria ocupada pelo pool (em bytes)
+  size_t memoria() const;
+};
+
+/* *************************
+   * CLASSE TEXTO          *
+   ************************* */
+
+/// Cadeia de caracteres imutavel armazenada no pool global de textos.
+/// Os caracteres ficam em blocos contiguos (arena) e textos iguais sao
+/// armazenados uma unica vez, de modo que um Texto eh apenas um ponteiro:
+/// copia, comparacao e espalhamento sao O(1) e nao alocam memoria.
+/// O pool eh preenchido principalmente durante Planejador::ler e existe ateh
+/// o fim do programa, de modo que ids, Caminhos e Alcancaveis continuam
+/// validos depois de destruido o Planejador que os gerou. Como cada texto eh
+/// armazenado uma unica vez, recarregar (ou falhar ao carregar) o mesmo mapa
+/// nao aumenta o pool: ele cresce apenas com textos ainda nao vistos.
+/// A criacao de Textos pode ser feita por varias threads.
+/// Um Texto criado num PoolTextos proprio (ex.: de MapaLadrilhado) soh eh
+/// igual (==) aos Textos do mesmo pool.
+class Texto
+{
+private:
+  const char* p;  // Caracteres no pool (terminados por '\0'), nullptr se vazio
+public:
+  // Construtor
+  Texto(): p(nullptr) {}
+  // Construtor a partir de uma string: inclui no pool, se necessario
+  explicit Texto(std::string_view S);
+  // Construtor a partir de uma string num pool proprio (nao no global)
+  Texto(std::string_view S, PoolTextos& P);
+  // O Texto S do pool global, ou vazio se S nao estiver no pool (nao inclui)
+  static Texto procura(std::string_view S);
+  // Tamanho: guardado no pool logo antes dos caracteres
+  size_t size() const
+  {
+    if (p==nullptr) return 0;
+    uint32_t n;
+    std::memcpy(&n, p-sizeof(n), sizeof(n));
+    return n;
+  }
+  bool empty() const
+  {
+    return p==nullptr;
+  }
+  // Acesso aos caracteres
+  char operator[](size_t i) const
+  {
+    return p[i];
+  }
+  std::string_view view() const
+  {
+    return (p ? std::string_view(p,size()) : std::string_view());
+  }
+  // Comparacao: textos iguais estao no mesmo endereco do pool
+  bool operator==(const Texto& T) const
+  {
+    return p==T.p;
+  }
+  bool operator!=(const Texto& T) const
+  {
+    return !operator==(T);
+  }
+  // Impressao
+  friend std::ostream& operator<<(std::ostream& X, const Texto& T)
+  {
+    return X<<T.view();
+  }
+  // Espalhamento (para uso em std::unordered_map)
+  friend struct std::hash<Texto>;
+
+  /// Memoria ocupada pelo pool de textos (em bytes)
+  static size_t memoriaPool();
+};
+
+/// Funcao de espalhamento de Texto
+namespace std
+{
+  template<> struct hash<Texto>
+  {
+    size_t operator()(const Texto& T) const
+    {
+      return hash<const char*>()(T.p);
+    }
+  };
+}
 
 /* *************************
    * CLASSE IDPONTO        *
@@ -13,12 +135,17 @@
 class IDPonto
 {
 private:
-  std::string t;
+  Texto t;
 public:
   // Construtor
-  IDPonto(): t("") {}
+  IDPonto(): t() {}
   // Atribuicao de string
   void set(std::string&& S);
+  // Atribuicao de um Texto jah armazenado (em qualquer pool)
+  void set(const Texto& T)
+  {
+    t = (T.size()>=2 && T[0]=='#') ? T : Texto();
+  }
   // Teste de validade
   bool valid() const
   {
@@ -38,8 +165,22 @@ public:
   {
     return X<<ID.t;
   }
+  // Espalhamento (para uso em std::unordered_map)
+  friend struct std::hash<IDPonto>;
 };
 
+/// Funcao de espalhamento de IDPonto
+namespace std
+{
+  template<> struct hash<IDPonto>
+  {
+    size_t operator()(const IDPonto& ID) const
+    {
+      return hash<Texto>()(ID.t);
+    }
+  };
+}
+
 /* *************************
    * CLASSE IDROTA         *
    ************************* */
@@ -48,12 +189,17 @@ public:
 class IDRota
 {
 private:
-  std::string t;
+  Texto t;
 public:
   // Construtor
-  IDRota(): t("") {}
+  IDRota(): t() {}
   // Atribuicao de string temporaria
   void set(std::string&& S);
+  // Atribuicao de um Texto jah armazenado (em qualquer pool)
+  void set(const Texto& T)
+  {
+    t = (T.size()>=2 && T[0]=='&') ? T : Texto();
+  }
   // Teste de validade
   bool valid() const
   {
@@ -73,8 +219,22 @@ public:
   {
     return X<<ID.t;
   }
+  // Espalhamento (para uso em std::unordered_map)
+  friend struct std::hash<IDRota>;
 };
 
+/// Funcao de espalhamento de IDRota
+namespace std
+{
+  template<> struct hash<IDRota>
+  {
+    size_t operator()(const IDRota& ID) const
+    {
+      return hash<Texto>()(ID.t);
+    }
+  };
+}
+
 /* *************************
    * CLASSE PONTO          *
    ************************* */
@@ -83,12 +243,12 @@ public:
 struct Ponto
 {
   IDPonto id;        // Identificador do ponto
-  std::string nome;  // Denominacao usual do ponto
+  Texto nome;        // Denominacao usual do ponto
   double latitude;   // Em graus: -90 polo sul, +90 polo norte
   double longitude;  // Em graus: de -180 a +180 (positivos a leste de Greenwich,
                      //                           negativos a oeste de Greenwich)
   // Construtor default
-  Ponto(): id(), nome(""), latitude(0.0), longitude(0.0) {}
+  Ponto(): id(), nome(), latitude(0.0), longitude(0.0) {}
   // Teste de validade
   bool valid() const
   {
@@ -110,6 +270,8 @@ bool operator!=(const Ponto& outro) const {
 
 /// Distancia entre 2 pontos (formula de haversine)
 double haversine(const Ponto& P1, const Ponto& P2);
+/// Distancia entre 2 coordenadas em graus (formula de haversine)
+double haversine(double lat1, double lon1, double lat2, double lon2);
 
 /* *************************
    * CLASSE ROTA           *
@@ -119,12 +281,12 @@ double haversine(const Ponto& P1, const Ponto& P2);
 struct Rota
 {
   IDRota id;              // Identificador da rota
-  std::string nome;       // Denominacao usual da rota
+  Texto nome;             // Denominacao usual da rota
   IDPonto extremidade[2]; // Ids dos pontos extremos da rota
   double comprimento;     // Comprimento da rota (em km)
 
   // Construtor default
-  Rota(): id(), nome(""), extremidade(), comprimento(0.0) {}
+  Rota(): id(), nome(), extremidade(), comprimento(0.0) {}
   // Teste de validade
   bool valid() const
   {
@@ -157,6 +319,29 @@ bool operator!=(const Rota& outra) const {
 /// No ultimo elemento, o ponto eh o destino.
 using Caminho = std::list< std::pair<IDRota,IDPonto> >;
 
+/* *************************
+   * CLASSE ALCANCE        *
+   ************************* */
+
+/// Um ponto alcancado numa busca de alcance a partir de uma origem.
+/// Os campos id_rt e id_ant formam a arvore de caminhos mais curtos:
+/// na origem, a rota eh vazia == IDRota() e o ponto anterior eh vazio == IDPonto().
+struct Alcance
+{
+  IDPonto id_pt;   // Ponto alcancado
+  IDRota id_rt;    // Rota que trouxe do ponto anterior ateh id_pt
+  IDPonto id_ant;  // Ponto anterior no caminho mais curto
+  double dist;     // Distancia minima a partir da origem (em km)
+};
+
+/// Os pontos alcancados a partir de uma origem, em ordem crescente de distancia.
+/// O 1o elemento eh sempre a origem, com distancia 0.
+using Alcancaveis = std::vector<Alcance>;
+
+/// Extrai de um conjunto de pontos alcancados o caminho ateh o destino.
+/// Retorna false (e C vazio) se o destino nao pertence a A.
+bool extraiCaminho(const Alcancaveis& A, const IDPonto& id_destino, Caminho& C);
+
 /* *************************
    * CLASSE PLANEJADOR     *
    ************************* */
@@ -169,9 +354,36 @@ private:
   std::list<Ponto> pontos;
   std::list<Rota> rotas;
 
+  /// Uma rota vista a partir de uma de suas extremidades
+  struct Vizinho
+  {
+    IDRota id_rt;        // Rota incidente no ponto
+    IDPonto id_pt;       // Extremidade oposta da rota
+    double comprimento;  // Comprimento da rota (em km)
+  };
+  /// Um ponto no grafo usado pelas buscas
+  struct NohMapa
+  {
+    double latitude;              // Coordenadas do ponto
+    double longitude;
+    std::vector<Vizinho> rotas;   // Rotas incidentes, na ordem do arquivo de rotas
+  };
+  /// Indice de todos os pontos do mapa com suas rotas incidentes.
+  /// Construido em ler, evita percorrer as listas de pontos e de rotas
+  /// a cada expansao das buscas.
+  std::unordered_map<IDPonto, NohMapa> grafo;
+
+  /// Monta o grafo a partir das listas de pontos e de rotas
+  void indexarGrafo();
+
+  // As buscas percorrem o grafo
+  friend class BuscaOrigem;
+  friend struct GrafoMemoria;
+  friend class TabelaDistancias;
+
 public:
   /// Cria um mapa vazio
-  Planejador(): pontos(), rotas() {}
+  Planejador(): pontos(), rotas(), grafo() {}
 
   /// Cria um mapa com o conteudo dos arquivos arq_pontos e arq_rotas
   Planejador(const std::string& arq_pontos,
@@ -213,6 +425,22 @@ public:
   bool ler(const std::string& arq_pontos,
            const std::string& arq_rotas);
 
+  /// Leh um mapa dos arquivos arq_pontos e arq_rotas usando num_threads threads
+  /// (0 == numero de nucleos disponiveis): os dois arquivos sao mapeados em
+  /// memoria e lidos ao mesmo tempo, cada um dividido em trechos alinhados em
+  /// inicio de linha, e as verificacoes de ids tambem sao feitas em paralelo.
+  /// O mapa resultante eh identico ao de ler. Em caso de erro, repete a leitura
+  /// serial, de modo que o erro reportado e o retorno tambem sao os mesmos de ler.
+  bool lerParalelo(const std::string& arq_pontos,
+                   const std::string& arq_rotas,
+                   unsigned num_threads = 0);
+
+  /// Grava o mapa no diretorio dir dividido em ladrilhos geograficos de
+  /// tam_graus x tam_graus graus, para buscas com MapaLadrilhado
+  /// (ver planejador-ladrilhos.h). A divisao eh feita a partir do mapa em memoria.
+  /// Retorna false se o mapa estiver vazio ou nao conseguir gravar os arquivos.
+  bool salvarLadrilhos(const std::string& dir, double tam_graus) const;
+
   /// Calcula o caminho mais curto no mapa entre origem e destino, usando o algoritmo A*
   /// Retorna o comprimento do caminho encontrado.
   /// (<0 se parametros invalidos ou se nao existe caminho).
@@ -225,6 +453,169 @@ public:
   double calculaCaminho(const IDPonto& id_origem,
                         const IDPonto& id_destino,
                         Caminho& C, int& NA, int& NF);
+
+  /// Calcula todos os pontos alcancaveis a partir da origem por caminhos de
+  /// comprimento <= dist_max, usando o algoritmo de Dijkstra limitado:
+  /// a busca termina assim que a fronteira ultrapassa dist_max.
+  /// Retorna o numero de pontos alcancados (<0 se parametros invalidos).
+  /// O parametro A retorna os pontos alcancados com suas distancias e a arvore
+  /// de caminhos utilizada (vazio se parametros invalidos).
+  int calculaAlcance(const IDPonto& id_origem, double dist_max,
+                     Alcancaveis& A) const;
+
+  /// Calcula o alcance de varias origens em paralelo, com num_threads threads
+  /// (0 == numero de nucleos disponiveis).
+  /// Retorna o numero de origens validas.
+  /// O parametro A retorna, na mesma ordem de origens, o resultado de
+  /// calculaAlcance para cada uma delas.
+  int calculaAlcances(const std::vector<IDPonto>& origens, double dist_max,
+                      std::vector<Alcancaveis>& A,
+                      unsigned num_threads = 0) const;
+};
+
+/* *************************
+   * CLASSE BUSCAORIGEM    *
+   ************************* */
+
+/// Busca de caminhos mais curtos a partir de uma origem fixa (algoritmo de Dijkstra)
+/// que guarda os conjuntos Aberto e Fechado entre consultas.
+/// Um destino jah fechado eh respondido sem nova expansao; caso contrario, a busca
+/// eh retomada de onde parou e expandida apenas ateh fechar o destino.
+/// A busca referencia o Planejador: deve ser descartada se o mapa for alterado.
+class BuscaOrigem
+{
+private:
+  const Planejador* G;             // Mapa onde eh feita a busca
+  IDPonto origem;                  // Origem de todos os caminhos
+  std::vector<Alcance> rotulos;    // Melhor rotulo conhecido de cada ponto descoberto
+  std::vector<bool> fechado;       // Se o rotulo de mesmo indice jah foi fechado
+  std::unordered_map<IDPonto, size_t> indice;  // Indice do rotulo de cada ponto
+  std::vector<size_t> fechados;    // Rotulos fechados, em ordem de fechamento
+  /// Fronteira (heap minimo de <distancia,rotulo>). Pode conter entradas
+  /// obsoletas, que sao descartadas ao chegar ao topo.
+  std::vector< std::pair<double,size_t> > Aberto;
+  size_t num_abertos;              // Numero de rotulos em aberto (sem as obsoletas)
+  double limite;                   // Rotulos com distancia maior nunca sao abertos
+
+  /// Descarta as entradas obsoletas do topo da fronteira
+  void limpaTopo();
+  /// Fecha o rotulo do topo da fronteira e relaxa suas rotas.
+  /// Retorna o indice do rotulo fechado.
+  size_t fechaProximo();
+
+public:
+  /// Inicia uma busca a partir de id_origem no mapa.
+  /// Se a origem nao existir no mapa, a busca eh invalida.
+  /// Com dist_max finito, os pontos mais distantes que dist_max nem entram
+  /// na fronteira: a busca soh responde por caminhos de comprimento <= dist_max.
+  BuscaOrigem(const Planejador& Mapa, const IDPonto& id_origem,
+              double dist_max = std::numeric_limits<double>::infinity());
+
+  /// Teste de validade
+  bool valid() const
+  {
+    return !rotulos.empty();
+  }
+
+  /// A origem da busca
+  const IDPonto& getOrigem() const
+  {
+    return origem;
+  }
+
+  /// Testa se todos os pontos alcancaveis jah foram fechados
+  bool concluida() const
+  {
+    return num_abertos == 0;
+  }
+
+  /// Expande a busca ateh fechar id_destino ou esgotar a fronteira.
+  /// Retorna true se o destino estah fechado.
+  bool expandir(const IDPonto& id_destino);
+
+  /// Expande a busca ateh fechar todos os pontos com distancia <= dist_max.
+  void expandir(double dist_max);
+
+  /// Calcula o caminho mais curto da origem ateh o destino, retomando a busca
+  /// apenas se o destino ainda nao foi fechado.
+  /// Retorno e parametros como em Planejador::calculaCaminho; NA e NF
+  /// correspondem aos conjuntos acumulados desde a criacao da busca.
+  double calculaCaminho(const IDPonto& id_destino,
+                        Caminho& C, int& NA, int& NF);
+
+  /// Retorna em A os pontos jah fechados com distancia <= dist_max,
+  /// em ordem crescente de distancia.
+  void alcancados(double dist_max, Alcancaveis& A) const;
+
+  /// Numero de nos em aberto e em fechado
+  int numAbertos() const
+  {
+    return num_abertos;
+  }
+  int numFechados() const
+  {
+    return fechados.size();
+  }
+
+  /// Estimativa da memoria ocupada pela busca (em bytes)
+  size_t memoria() const;
+};
+
+/* *************************
+   * CLASSE CACHEBUSCAS    *
+   ************************* */
+
+/// Conjunto de buscas por origem mantidas entre consultas.
+/// Quando o numero de origens ou a memoria total ultrapassam os limites
+/// configurados, as buscas usadas menos recentemente sao descartadas
+/// (a busca mais recente eh sempre mantida).
+/// Como BuscaOrigem, deve ser esvaziado se o mapa for alterado.
+class CacheBuscas
+{
+private:
+  const Planejador* G;
+  size_t max_origens;  // Numero maximo de origens guardadas
+  size_t max_memoria;  // Memoria maxima ocupada pelas buscas (em bytes)
+  /// Buscas guardadas, da usada mais recentemente para a menos recente
+  std::list<BuscaOrigem> buscas;
+  std::unordered_map<IDPonto, std::list<BuscaOrigem>::iterator> indice;
+  /// Ultima busca invalida (origem inexistente), guardada fora das buscas
+  std::list<BuscaOrigem> invalida;
+
+  /// Descarta as buscas menos recentes ateh respeitar os limites
+  void aplicaLimites();
+
+public:
+  /// Cria um cache vazio para o mapa
+  CacheBuscas(const Planejador& Mapa, size_t MaxOrigens = 16,
+              size_t MaxMemoria = 256*1024*1024):
+    G(&Mapa), max_origens(MaxOrigens), max_memoria(MaxMemoria), buscas(), indice(), invalida() {}
+
+  /// Altera os limites, descartando buscas se necessario
+  void setLimites(size_t MaxOrigens, size_t MaxMemoria);
+
+  /// Descarta todas as buscas
+  void clear();
+
+  /// Numero de origens guardadas
+  size_t size() const
+  {
+    return buscas.size();
+  }
+
+  /// Memoria total ocupada pelas buscas (em bytes)
+  size_t memoria() const;
+
+  /// Retorna a busca da origem, criando-a se necessario,
+  /// e a torna a mais recente. Uma busca invalida nao eh guardada
+  /// e nao descarta nenhuma das buscas guardadas.
+  BuscaOrigem& getBusca(const IDPonto& id_origem);
+
+  /// Calcula o caminho mais curto entre origem e destino reaproveitando a busca
+  /// guardada para a origem. Retorno e parametros como em BuscaOrigem::calculaCaminho.
+  double calculaCaminho(const IDPonto& id_origem,
+                        const IDPonto& id_destino,
+                        Caminho& C, int& NA, int& NF);
 };
 
 #endif // _PLANEJADOR_H_
@@ -0,0 +1,186 @@
+#ifndef _GERADOR_MAPAS_H_
+#define _GERADOR_MAPAS_H_
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <random>
+#include <fstream>
+#include <limits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+#include "planejador.h"
+
+/// *******************************************************************************
+/// Geracao de mapas aleatorios para os testes e o benchmark
+/// *******************************************************************************
+
+/// Uma rota de um mapa gerado
+struct RotaGerada
+{
+  size_t a, b;         // Indices das extremidades
+  double comprimento;  // Comprimento (em km), exatamente como gravado no arquivo
+};
+
+/// Um mapa gerado: pontos espalhados ao acaso em componentes separados, cada
+/// ponto ligado aos vizinhos mais proximos do mesmo componente, como uma malha
+/// viaria. O comprimento de cada rota eh maior que a distancia em linha reta
+/// entre as extremidades, para que a heuristica do A* seja admissivel.
+struct MapaGerado
+{
+  std::vector<std::string> id_pt;   // "#0", "#1", ...
+  std::vector<double> latitude;     // Exatamente como lidas do arquivo
+  std::vector<double> longitude;
+  std::vector<std::string> id_rt;   // "&0", "&1", ...
+  std::vector<RotaGerada> rotas;
+};
+
+/// Gera um mapa com num_pontos pontos em num_componentes componentes
+/// (sem caminho entre eles), cada ponto ligado a num_vizinhos vizinhos.
+/// Algumas rotas sao duplicadas com outro comprimento.
+inline MapaGerado geraMapa(size_t num_pontos, unsigned num_vizinhos,
+                           unsigned semente, unsigned num_componentes = 1)
+{
+  MapaGerado M;
+  std::mt19937 gerador(semente);
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Cada componente ocupa um quadrado de lado proporcional a raiz do numero
+  // de pontos (~1 ponto por 4 km2), afastado dos demais.
+  // As coordenadas sao gravadas com 5 casas e relidas, como em Planejador::ler.
+  const double lado = 0.02*std::sqrt(double(num_pontos)/num_componentes) + 0.01;
+  std::vector<unsigned> componente(num_pontos);
+  char buf[64];
+  for (size_t i = 0; i < num_pontos; ++i)
+  {
+    componente[i] = i % num_componentes;
+    double lat = -5.0 - unif(gerador)*lado;
+    double lon = -35.0 - unif(gerador)*lado - componente[i]*2.0*lado;
+    std::snprintf(buf, sizeof(buf), "%.5f", lat);
+    M.latitude.push_back(std::strtod(buf, nullptr));
+    std::snprintf(buf, sizeof(buf), "%.5f", lon);
+    M.longitude.push_back(std::strtod(buf, nullptr));
+    M.id_pt.push_back("#" + std::to_string(i));
+  }
+
+  // Vizinhos mais proximos, procurados numa grade de celulas
+  const double tam_celula = 0.03;
+  auto celula = [&](double lat, double lon) {
+    return std::make_pair(long(std::floor(lat/tam_celula)), long(std::floor(lon/tam_celula)));
+  };
+  std::unordered_map<long long, std::vector<size_t> > grade;
+  auto chave = [](long l, long c) { return (static_cast<long long>(l) << 32) ^ (c & 0xffffffffLL); };
+  for (size_t i = 0; i < num_pontos; ++i)
+  {
+    auto [l, c] = celula(M.latitude[i], M.longitude[i]);
+    grade[chave(l, c)].push_back(i);
+  }
+  auto acrescentaRota = [&](size_t a, size_t b, double fator) {
+    double d = haversine(M.latitude[a], M.longitude[a], M.latitude[b], M.longitude[b]);
+    std::snprintf(buf, sizeof(buf), "%.3f", d*fator + 0.001);
+    M.id_rt.push_back("&" + std::to_string(M.rotas.size()));
+    M.rotas.push_back({a, b, std::strtod(buf, nullptr)});
+  };
+  std::vector< std::pair<double,size_t> > candidatos;
+  std::unordered_set<size_t> ligados;
+  for (size_t i = 0; i < num_pontos; ++i)
+  {
+    auto [l, c] = celula(M.latitude[i], M.longitude[i]);
+    candidatos.clear();
+    for (long r = 1; r <= 3 && candidatos.size() < num_vizinhos; ++r)
+    {
+      candidatos.clear();
+      for (long dl = -r; dl <= r; ++dl)
+      {
+        for (long dc = -r; dc <= r; ++dc)
+        {
+          auto it = grade.find(chave(l+dl, c+dc));
+          if (it == grade.end()) continue;
+          for (size_t j : it->second)
+          {
+            if (j == i || componente[j] != componente[i]) continue;
+            candidatos.push_back({haversine(M.latitude[i], M.longitude[i],
+                                            M.latitude[j], M.longitude[j]), j});
+          }
+        }
+      }
+    }
+    std::sort(candidatos.begin(), candidatos.end());
+    for (size_t k = 0; k < candidatos.size() && k < num_vizinhos; ++k)
+    {
+      // Liga i a j apenas uma vez, mesmo que cada um esteja entre os vizinhos do outro
+      size_t j = candidatos[k].second;
+      if (!ligados.insert(std::min(i, j)*num_pontos + std::max(i, j)).second) continue;
+      acrescentaRota(i, j, 1.05 + 0.35*unif(gerador));
+      if (unif(gerador) < 0.02) acrescentaRota(j, i, 1.5 + unif(gerador));
+    }
+  }
+  return M;
+}
+
+/// Grava o mapa nos arquivos arq_pontos e arq_rotas, no formato de Planejador::ler.
+/// Retorna false se nao conseguir gravar.
+inline bool gravaMapa(const MapaGerado& M, const std::string& arq_pontos,
+                      const std::string& arq_rotas)
+{
+  std::ofstream P(arq_pontos), R(arq_rotas);
+  if (!P.is_open() || !R.is_open()) return false;
+  char buf[256];
+  P << "ID;Nome;Latitude;Longitude\n";
+  for (size_t i = 0; i < M.id_pt.size(); ++i)
+  {
+    std::snprintf(buf, sizeof(buf), "%s;Ponto %zu;%.5f;%.5f\n",
+                  M.id_pt[i].c_str(), i, M.latitude[i], M.longitude[i]);
+    P << buf;
+  }
+  R << "ID;Nome;Extremidade 1;Extremidade 2;Comprimento\n";
+  for (size_t k = 0; k < M.rotas.size(); ++k)
+  {
+    std::snprintf(buf, sizeof(buf), "%s;Rota %zu;%s;%s;%.3f\n",
+                  M.id_rt[k].c_str(), k, M.id_pt[M.rotas[k].a].c_str(),
+                  M.id_pt[M.rotas[k].b].c_str(), M.rotas[k].comprimento);
+    R << buf;
+  }
+  return bool(P) && bool(R);
+}
+
+/// Distancias minimas da origem a todos os pontos do mapa (algoritmo de
+/// Dijkstra de referencia, sem nenhuma das otimizacoes do Planejador).
+/// Os pontos sem caminho ficam com distancia infinita.
+inline std::vector<double> dijkstraReferencia(const MapaGerado& M, size_t origem)
+{
+  const size_t n = M.id_pt.size();
+  std::vector< std::vector< std::pair<size_t,double> > > adj(n);
+  for (const RotaGerada& R : M.rotas)
+  {
+    adj[R.a].push_back({R.b, R.comprimento});
+    adj[R.b].push_back({R.a, R.comprimento});
+  }
+  std::vector<double> dist(n, std::numeric_limits<double>::infinity());
+  typedef std::pair<double,size_t> Entrada;
+  std::priority_queue< Entrada, std::vector<Entrada>, std::greater<Entrada> > fila;
+  dist[origem] = 0.0;
+  fila.push({0.0, origem});
+  while (!fila.empty())
+  {
+    auto [d, u] = fila.top();
+    fila.pop();
+    if (d > dist[u]) continue;
+    for (auto [v, w] : adj[u])
+    {
+      if (d+w < dist[v])
+      {
+        dist[v] = d+w;
+        fila.push({dist[v], v});
+      }
+    }
+  }
+  return dist;
+}
+
+#endif // _GERADOR_MAPAS_H_
@@ -0,0 +1,568 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cctype>
+
+#include "planejador.h"
+#include "planejador-ladrilhos.h"
+#include "planejador-tabela.h"
+#include "gerador-mapas.h"
+
+using namespace std;
+
+/// *******************************************************************************
+/// Testes do Planejador: os resultados sao comparados com um algoritmo de
+/// Dijkstra de referencia (gerador-mapas.h) em mapas gerados ao acaso.
+/// Uso: testes-planejador [teste ...]  (sem argumentos, executa todos)
+/// *******************************************************************************
+
+namespace
+{
+int num_falhas = 0;
+
+/// Registra uma falha se a condicao for falsa
+#define VERIFICA(cond) \
+  do { if (!(cond)) falha(__FILE__, __LINE__, #cond); } while (0)
+
+void falha(const char* arq, int linha, const char* cond)
+{
+  // Limita as mensagens quando muitas verificacoes falham pelo mesmo motivo
+  if (++num_falhas <= 20) cerr << arq << ":" << linha << ": falhou: " << cond << endl;
+}
+
+/// Compara comprimentos calculados somando as rotas em ordens diferentes
+bool proximos(double a, double b)
+{
+  return fabs(a-b) <= 1e-9*max(1.0, fabs(b));
+}
+
+/// Um mapa gerado, gravado em arquivos e lido pelo Planejador
+struct MapaTeste
+{
+  MapaGerado M;
+  string arq_pontos, arq_rotas;
+  Planejador G;
+  vector<IDPonto> ids;                  // ids[i] == id do ponto i de M
+  unordered_map<IDRota, size_t> rota;   // Indice em M de cada rota
+};
+
+/// Gera o mapa nome e o leh no Planejador. Retorna false se nao conseguir.
+bool preparaMapa(const string& nome, size_t num_pontos, unsigned num_vizinhos,
+                 unsigned semente, unsigned num_componentes, MapaTeste& T)
+{
+  filesystem::create_directories("mapas-teste");
+  T.arq_pontos = "mapas-teste/" + nome + "-pontos.txt";
+  T.arq_rotas = "mapas-teste/" + nome + "-rotas.txt";
+  T.M = geraMapa(num_pontos, num_vizinhos, semente, num_componentes);
+  if (!gravaMapa(T.M, T.arq_pontos, T.arq_rotas) || !T.G.ler(T.arq_pontos, T.arq_rotas))
+  {
+    cerr << "Erro na preparacao do mapa " << nome << endl;
+    ++num_falhas;
+    return false;
+  }
+  T.ids.resize(T.M.id_pt.size());
+  for (size_t i = 0; i < T.ids.size(); ++i) T.ids[i].set(string(T.M.id_pt[i]));
+  for (size_t k = 0; k < T.M.id_rt.size(); ++k)
+  {
+    IDRota Id;
+    Id.set(string(T.M.id_rt[k]));
+    T.rota.emplace(Id, k);
+  }
+  return true;
+}
+
+/// Verifica se C eh um caminho de o ateh d formado por rotas do mapa,
+/// com comprimento total compr
+void verificaCaminho(const MapaTeste& T, const Caminho& C, size_t o, size_t d, double compr)
+{
+  VERIFICA(!C.empty());
+  if (C.empty()) return;
+  VERIFICA(C.front().first == IDRota());
+  VERIFICA(C.front().second == T.ids[o]);
+  VERIFICA(C.back().second == T.ids[d]);
+
+  double soma(0.0);
+  IDPonto ant = C.front().second;
+  for (auto it = next(C.begin()); it != C.end(); ++it)
+  {
+    auto r = T.rota.find(it->first);
+    VERIFICA(r != T.rota.end());
+    if (r == T.rota.end()) return;
+    const RotaGerada& R = T.M.rotas[r->second];
+    VERIFICA((T.ids[R.a] == ant && T.ids[R.b] == it->second) ||
+             (T.ids[R.b] == ant && T.ids[R.a] == it->second));
+    soma += R.comprimento;
+    ant = it->second;
+  }
+  VERIFICA(proximos(soma, compr));
+}
+
+/// Uma amostra de num indices de pontos espalhados pelo mapa
+vector<size_t> amostra(const MapaTeste& T, size_t num)
+{
+  vector<size_t> A;
+  for (size_t i = 0; i < num; ++i) A.push_back(i*T.ids.size()/num);
+  return A;
+}
+
+/// calculaCaminho (A*) contra o Dijkstra de referencia
+void testaCaminho()
+{
+  struct Config { size_t num_pontos; unsigned num_vizinhos, semente, num_componentes; };
+  for (const Config& c : {Config{300, 3, 1, 1}, Config{400, 4, 2, 3}, Config{250, 2, 3, 2}})
+  {
+    MapaTeste T;
+    if (!preparaMapa("caminho" + to_string(c.semente), c.num_pontos, c.num_vizinhos,
+                     c.semente, c.num_componentes, T)) continue;
+    Caminho C;
+    int NA, NF;
+    for (size_t o : amostra(T, 20))
+    {
+      vector<double> ref = dijkstraReferencia(T.M, o);
+      for (size_t d = 0; d < T.ids.size(); ++d)
+      {
+        double compr = T.G.calculaCaminho(T.ids[o], T.ids[d], C, NA, NF);
+        VERIFICA(NA >= 0 && NF > 0);
+        if (isinf(ref[d]))
+        {
+          VERIFICA(compr < 0.0);
+          VERIFICA(C.empty());
+        }
+        else
+        {
+          VERIFICA(proximos(compr, ref[d]));
+          verificaCaminho(T, C, o, d, compr);
+        }
+      }
+    }
+
+    // Parametros invalidos
+    IDPonto inexistente, invalido;
+    inexistente.set("#inexistente");
+    double compr = T.G.calculaCaminho(inexistente, T.ids[0], C, NA, NF);
+    VERIFICA(compr < 0.0 && C.empty() && NA < 0 && NF < 0);
+    compr = T.G.calculaCaminho(T.ids[0], invalido, C, NA, NF);
+    VERIFICA(compr < 0.0 && C.empty() && NA < 0 && NF < 0);
+  }
+}
+
+/// Conteudo de um mapa, como impresso por imprimirPontos e imprimirRotas
+string impressao(const Planejador& G)
+{
+  ostringstream S;
+  streambuf* antigo = cout.rdbuf(S.rdbuf());
+  G.imprimirPontos();
+  G.imprimirRotas();
+  cout.rdbuf(antigo);
+  return S.str();
+}
+
+/// lerParalelo contra ler, em arquivos grandes o bastante para serem divididos
+void comparaLeituras()
+{
+  MapaTeste T;
+  if (!preparaMapa("leitura", 40000, 3, 4, 1, T)) return;
+  const string ref = impressao(T.G);
+  VERIFICA(!ref.empty());
+  for (unsigned num_threads : {1u, 2u, 5u})
+  {
+    Planejador P;
+    VERIFICA(P.lerParalelo(T.arq_pontos, T.arq_rotas, num_threads));
+    VERIFICA(impressao(P) == ref);
+  }
+
+  // Um ponto repetido no final do arquivo: as duas leituras falham
+  // e deixam o mapa inalterado
+  {
+    ofstream arq(T.arq_pontos, ios::app);
+    arq << T.M.id_pt[0] << ";Repetido;-5.0;-35.0\n";
+  }
+  VERIFICA(!T.G.ler(T.arq_pontos, T.arq_rotas));
+  VERIFICA(!T.G.lerParalelo(T.arq_pontos, T.arq_rotas, 3));
+  VERIFICA(impressao(T.G) == ref);
+}
+
+/// Leituras e liberacao do pool de textos junto com o ultimo Planejador
+void testaLeitura()
+{
+  comparaLeituras();
+
+  // Uma id criada antes de um Planejador e um Caminho calculado por ele
+  // continuam validos depois que o Planejador eh destruido
+  IDPonto id;
+  id.set(string("#abc"));
+  Caminho C;
+  {
+    MapaTeste T;
+    if (!preparaMapa("leitura-pool", 200, 3, 5, 1, T)) return;
+    int NA, NF;
+    VERIFICA(T.G.calculaCaminho(T.ids[0], T.ids[1], C, NA, NF) > 0.0);
+    // Recarregar o mesmo mapa nao aumenta o pool
+    const size_t memoria = Texto::memoriaPool();
+    VERIFICA(T.G.ler(T.arq_pontos, T.arq_rotas));
+    VERIFICA(Texto::memoriaPool() == memoria);
+  }
+  ostringstream S;
+  S << id;
+  VERIFICA(S.str() == "#abc");
+  VERIFICA(!C.empty() && C.front().second.valid() && C.back().second.valid());
+  for (const auto& [rt, pt] : C) S << rt << pt;
+  VERIFICA(S.str().size() > 4);
+}
+
+/// calculaAlcance, calculaAlcances, BuscaOrigem e CacheBuscas
+void testaAlcance()
+{
+  MapaTeste T;
+  if (!preparaMapa("alcance", 500, 3, 5, 2, T)) return;
+  const double dist_max = 15.0;
+  const vector<size_t> origens = amostra(T, 10);
+
+  vector<IDPonto> ids_origens;
+  vector<Alcancaveis> serial;
+  for (size_t o : origens)
+  {
+    vector<double> ref = dijkstraReferencia(T.M, o);
+    Alcancaveis A;
+    int num = T.G.calculaAlcance(T.ids[o], dist_max, A);
+    VERIFICA(num == int(A.size()));
+    VERIFICA(size_t(num) == size_t(count_if(ref.begin(), ref.end(),
+                                            [&](double d) { return d <= dist_max; })));
+    VERIFICA(!A.empty() && A[0].id_pt == T.ids[o] && A[0].dist == 0.0);
+
+    unordered_map<IDPonto, size_t> indice;
+    for (size_t i = 0; i < T.ids.size(); ++i) indice.emplace(T.ids[i], i);
+    for (size_t k = 0; k < A.size(); ++k)
+    {
+      size_t d = indice.at(A[k].id_pt);
+      VERIFICA(A[k].dist <= dist_max);
+      VERIFICA(proximos(A[k].dist, ref[d]));
+      VERIFICA(k == 0 || A[k-1].dist <= A[k].dist);
+      Caminho C;
+      VERIFICA(extraiCaminho(A, A[k].id_pt, C));
+      verificaCaminho(T, C, o, d, A[k].dist);
+    }
+    ids_origens.push_back(T.ids[o]);
+    serial.push_back(A);
+  }
+
+  // Em paralelo, os mesmos resultados na mesma ordem
+  vector<Alcancaveis> paralelo;
+  VERIFICA(T.G.calculaAlcances(ids_origens, dist_max, paralelo, 3) == int(origens.size()));
+  VERIFICA(paralelo.size() == serial.size());
+  for (size_t i = 0; i < paralelo.size() && i < serial.size(); ++i)
+  {
+    VERIFICA(paralelo[i].size() == serial[i].size());
+    for (size_t k = 0; k < paralelo[i].size() && k < serial[i].size(); ++k)
+    {
+      VERIFICA(paralelo[i][k].id_pt == serial[i][k].id_pt &&
+               paralelo[i][k].dist == serial[i][k].dist);
+    }
+  }
+
+  // Buscas retomadas, com descarte das origens menos recentes
+  CacheBuscas Cache(T.G, 3);
+  vector< vector<double> > refs;
+  for (size_t o : origens) refs.push_back(dijkstraReferencia(T.M, o));
+  Caminho C;
+  int NA, NF;
+  for (size_t k = 0; k < 400; ++k)
+  {
+    size_t i = (k*7) % origens.size();
+    size_t d = (k*131) % T.ids.size();
+    double compr = Cache.calculaCaminho(T.ids[origens[i]], T.ids[d], C, NA, NF);
+    VERIFICA(Cache.size() <= 3);
+    if (isinf(refs[i][d]))
+    {
+      VERIFICA(compr < 0.0 && C.empty());
+    }
+    else
+    {
+      VERIFICA(proximos(compr, refs[i][d]));
+      verificaCaminho(T, C, origens[i], d, compr);
+    }
+  }
+
+  // Origens inexistentes nao ocupam o lugar das buscas guardadas
+  const size_t guardadas = Cache.size();
+  const size_t memoria = Cache.memoria();
+  for (size_t k = 0; k < 5; ++k)
+  {
+    IDPonto Id;
+    Id.set("inexistente" + to_string(k));
+    VERIFICA(!Cache.getBusca(Id).valid());
+    VERIFICA(Cache.calculaCaminho(Id, T.ids[0], C, NA, NF) < 0.0 && NA < 0);
+  }
+  VERIFICA(Cache.size() == guardadas && Cache.memoria() == memoria);
+}
+
+/// TabelaDistancias (contraction hierarchies + PHAST) e o arquivo da tabela
+void testaTabela()
+{
+  MapaTeste T;
+  if (!preparaMapa("tabela", 600, 3, 6, 2, T)) return;
+  TabelaDistancias Tab(T.G);
+  VERIFICA(!Tab.empty());
+
+  vector<IDPonto> origens;
+  vector<size_t> indices = amostra(T, 25);
+  for (size_t o : indices) origens.push_back(T.ids[o]);
+  vector<double> D;
+  VERIFICA(Tab.calculaTabela(origens, T.ids, D, 2));
+  VERIFICA(D.size() == origens.size()*T.ids.size());
+  if (D.size() != origens.size()*T.ids.size()) return;
+  for (size_t i = 0; i < indices.size(); ++i)
+  {
+    vector<double> ref = dijkstraReferencia(T.M, indices[i]);
+    for (size_t j = 0; j < T.ids.size(); ++j)
+    {
+      double d = D[i*T.ids.size()+j];
+      VERIFICA(isinf(ref[j]) ? d < 0.0 : proximos(d, ref[j]));
+    }
+  }
+
+  // O arquivo contem a mesma tabela
+  const string arq = "mapas-teste/tabela.bin";
+  VERIFICA(Tab.gravarTabela(arq, origens, T.ids, 3));
+  ifstream E(arq, ios::binary);
+  char magica[8];
+  uint64_t num_origens(0), num_destinos(0);
+  E.read(magica, sizeof(magica));
+  E.read(reinterpret_cast<char*>(&num_origens), sizeof(num_origens));
+  E.read(reinterpret_cast<char*>(&num_destinos), sizeof(num_destinos));
+  VERIFICA(E && memcmp(magica, "PLANTAB1", 8) == 0);
+  VERIFICA(num_origens == origens.size() && num_destinos == T.ids.size());
+  vector<double> lida(D.size());
+  E.read(reinterpret_cast<char*>(lida.data()), lida.size()*sizeof(double));
+  VERIFICA(E && lida == D);
+  string id;
+  for (size_t o : indices)
+  {
+    VERIFICA(getline(E, id, '\0') && id == T.M.id_pt[o]);
+  }
+  for (size_t j = 0; j < T.ids.size(); ++j)
+  {
+    VERIFICA(getline(E, id, '\0') && id == T.M.id_pt[j]);
+  }
+
+  // Parametros invalidos
+  IDPonto inexistente;
+  inexistente.set("#inexistente");
+  VERIFICA(!Tab.calculaTabela({inexistente}, T.ids, D) && D.empty());
+  VERIFICA(!TabelaDistancias().calculaTabela(origens, T.ids, D));
+}
+
+/// MapaLadrilhado contra o mapa em memoria, com pouca memoria para os ladrilhos
+void comparaLadrilhos()
+{
+  MapaTeste T;
+  if (!preparaMapa("ladrilhos", 800, 3, 7, 2, T)) return;
+  const string dir = "mapas-teste/ladrilhos";
+  filesystem::create_directories(dir);
+  VERIFICA(T.G.salvarLadrilhos(dir, 0.1));
+
+  // Cache menor que alguns pares de ladrilhos e cache que comporta todos
+  for (size_t max_memoria : {size_t(16*1024), size_t(256*1024*1024)})
+  {
+    MapaLadrilhado L(dir, max_memoria);
+    VERIFICA(!L.empty() && L.numLadrilhos() > 1);
+    if (L.empty()) return;
+
+    Caminho C1, C2;
+    int NA1, NF1, NA2, NF2;
+    for (size_t o : amostra(T, 15))
+    {
+      for (size_t d : amostra(T, 40))
+      {
+        double c1 = T.G.calculaCaminho(T.ids[o], T.ids[d], C1, NA1, NF1);
+        double c2 = L.calculaCaminho(T.ids[o], T.ids[d], C2, NA2, NF2);
+        VERIFICA(c1 == c2 && NA1 == NA2 && NF1 == NF2 && C1 == C2);
+      }
+    }
+    VERIFICA(L.getPonto(T.ids[3]) == T.G.getPonto(T.ids[3]));
+    // Apenas o ladrilho mais recente pode ultrapassar o limite sozinho
+    VERIFICA(L.memoria() <= max_memoria || L.numCarregados() == 1);
+    // Com espaco, os pre-carregamentos acontecem e nunca descartam ladrilhos
+    if (max_memoria > 16*1024)
+    {
+      VERIFICA(L.numPreCarregamentos() > 0);
+      VERIFICA(L.numCarregados() == L.numCarregamentos() + L.numPreCarregamentos());
+    }
+  }
+}
+
+/// Copia os ladrilhos de dir_orig para dir trocando os digitos das ids dos
+/// pontos por letras ("#12" -> "#bc"), exceto as ids de manter: as ids
+/// trocadas nunca foram incluidas no pool global de textos.
+/// As ids mantidas continuam sendo encontradas no diretorio.
+void renomeiaIds(const string& dir_orig, const string& dir, const vector<string>& manter)
+{
+  filesystem::create_directories(dir);
+  filesystem::copy_file(dir_orig + "/ladrilhos.idx", dir + "/ladrilhos.idx",
+                        filesystem::copy_options::overwrite_existing);
+  ifstream E(dir_orig + "/ladrilhos.dat", ios::binary);
+  string dados((istreambuf_iterator<char>(E)), istreambuf_iterator<char>());
+  for (size_t i = 1; i < dados.size(); ++i)
+  {
+    if (dados[i-1] != '\0' || dados[i] != '#') continue;
+    size_t j = i+1;
+    while (j < dados.size() && isdigit(static_cast<unsigned char>(dados[j]))) ++j;
+    if (j == i+1 || j == dados.size() || dados[j] != '\0') continue;
+    if (find(manter.begin(), manter.end(), dados.substr(i, j-i)) != manter.end()) continue;
+    for (size_t k = i+1; k < j; ++k) dados[k] = 'a' + (dados[k]-'0');
+  }
+  ofstream S(dir + "/ladrilhos.dat", ios::binary | ios::trunc);
+  S.write(dados.data(), dados.size());
+}
+
+/// MapaLadrilhado contra Planejador::calculaCaminho, textos retornados pelo
+/// mapa em ladrilhos fora do pool global e ladrilhos danificados
+void testaLadrilhos()
+{
+  comparaLadrilhos();
+  renomeiaIds("mapas-teste/ladrilhos", "mapas-teste/ladrilhos-renomeados", {"#0", "#400"});
+  MapaLadrilhado L("mapas-teste/ladrilhos-renomeados", 16*1024);
+  if (L.empty()) return;
+
+  IDPonto o, d;
+  o.set(string("#0"));
+  d.set(string("#400"));
+  Caminho C;
+  int NA, NF;
+  VERIFICA(L.calculaCaminho(o, d, C, NA, NF) > 0.0 && C.size() > 2);
+  if (C.size() <= 2) return;
+  VERIFICA(C.front().second == o && C.back().second == d);
+  ostringstream id;
+  id << next(C.begin())->second;
+  VERIFICA(Texto::procura(id.str()).empty());
+  VERIFICA(L.memoriaTextos() > 0);
+
+  // Copias danificadas: a abertura ou a carga do ladrilho falham (sem SIGBUS)
+  const string dir = "mapas-teste/ladrilhos-danificados";
+  filesystem::create_directories(dir);
+  for (const string arq : {"/ladrilhos.idx", "/ladrilhos.dat"})
+  {
+    filesystem::copy_file("mapas-teste/ladrilhos" + arq, dir + arq,
+                          filesystem::copy_options::overwrite_existing);
+  }
+  const auto tam_dados = filesystem::file_size(dir + "/ladrilhos.dat");
+  filesystem::resize_file(dir + "/ladrilhos.dat", tam_dados-1);
+  MapaLadrilhado D;
+  VERIFICA(!D.abrir(dir) && D.empty());
+
+  // Ladrilho 0 (no inicio do arquivo) com um numero de pontos impossivel
+  filesystem::resize_file(dir + "/ladrilhos.dat", tam_dados);
+  {
+    fstream arq(dir + "/ladrilhos.dat", ios::in | ios::out | ios::binary);
+    const uint32_t num_pontos = 0xFFFFFFFF;
+    arq.write(reinterpret_cast<const char*>(&num_pontos), sizeof(num_pontos));
+  }
+  VERIFICA(D.abrir(dir));
+  size_t invalidos = 0;
+  for (unsigned i = 0; i < 800; ++i)
+  {
+    IDPonto Id;
+    Id.set("#" + to_string(i));
+    if (!D.getPonto(Id).valid()) ++invalidos;
+  }
+  VERIFICA(invalidos > 0 && invalidos < 800);
+
+  // Ladrilho 0 com uma posicao fora das suas partes: no inicio das arestas
+  // de um ponto, na id do ponto 0 e na id da rota da aresta 0.
+  // Layout: cabecalho (8 bytes), pontos (24 bytes cada, id na posicao 16),
+  // arestas (40 bytes cada, vizinho na 24 e id da rota na 32) e inicio das
+  // arestas de cada ponto (4 bytes)
+  uint32_t cab[2];
+  {
+    ifstream arq("mapas-teste/ladrilhos/ladrilhos.dat", ios::binary);
+    arq.read(reinterpret_cast<char*>(cab), sizeof(cab));
+  }
+  const uint64_t pos_arestas = 8 + uint64_t(cab[0])*24;
+  const uint64_t pos_inicio = pos_arestas + uint64_t(cab[1])*40;
+  VERIFICA(cab[0] > 0 && cab[1] > 0);
+  for (const uint64_t pos : {pos_inicio + (cab[0] > 1 ? 4 : 0), uint64_t(8 + 16), pos_arestas + 32})
+  {
+    filesystem::copy_file("mapas-teste/ladrilhos/ladrilhos.dat", dir + "/ladrilhos.dat",
+                          filesystem::copy_options::overwrite_existing);
+    {
+      fstream arq(dir + "/ladrilhos.dat", ios::in | ios::out | ios::binary);
+      const uint32_t posicao = 0x7fffffff;
+      arq.seekp(pos);
+      arq.write(reinterpret_cast<const char*>(&posicao), sizeof(posicao));
+    }
+    VERIFICA(D.abrir(dir));
+    invalidos = 0;
+    for (unsigned i = 0; i < 800; ++i)
+    {
+      IDPonto Id;
+      Id.set("#" + to_string(i));
+      if (!D.getPonto(Id).valid()) ++invalidos;
+    }
+    VERIFICA(invalidos > 0 && invalidos < 800);
+  }
+
+  // Ladrilho 0 integro, mas com todas as arestas apontando para pontos
+  // inexistentes: as buscas que partem dele falham (sem acesso fora do ladrilho)
+  filesystem::copy_file("mapas-teste/ladrilhos/ladrilhos.dat", dir + "/ladrilhos.dat",
+                        filesystem::copy_options::overwrite_existing);
+  {
+    fstream arq(dir + "/ladrilhos.dat", ios::in | ios::out | ios::binary);
+    for (uint32_t k = 0; k < cab[1]; ++k)
+    {
+      uint64_t vizinho;
+      arq.seekg(pos_arestas + uint64_t(k)*40 + 24);
+      arq.read(reinterpret_cast<char*>(&vizinho), sizeof(vizinho));
+      vizinho |= 0xFFFFFFFF;
+      arq.seekp(pos_arestas + uint64_t(k)*40 + 24);
+      arq.write(reinterpret_cast<const char*>(&vizinho), sizeof(vizinho));
+    }
+  }
+  VERIFICA(D.abrir(dir));
+  size_t falhas = 0;
+  for (unsigned i = 0; i < 800; ++i)
+  {
+    IDPonto Id;
+    Id.set("#" + to_string(i));
+    if (D.calculaCaminho(Id, d, C, NA, NF) < 0.0) ++falhas;
+  }
+  VERIFICA(falhas > 0 && falhas < 800);
+}
+}
+
+int main(int argc, char** argv)
+{
+  const map< string, function<void()> > testes = {
+    {"caminho", testaCaminho},
+    {"leitura", testaLeitura},
+    {"alcance", testaAlcance},
+    {"tabela", testaTabela},
+    {"ladrilhos", testaLadrilhos}
+  };
+
+  vector<string> nomes(argv+1, argv+argc);
+  if (nomes.empty())
+  {
+    for (const auto& t : testes) nomes.push_back(t.first);
+  }
+  for (const string& nome : nomes)
+  {
+    auto it = testes.find(nome);
+    if (it == testes.end())
+    {
+      cerr << "Teste desconhecido: " << nome << endl;
+      return 2;
+    }
+    int falhas_antes = num_falhas;
+    it->second();
+    cout << nome << ": " << (num_falhas == falhas_antes ? "ok" : "FALHOU") << endl;
+  }
+  return (num_falhas == 0 ? 0 : 1);
+}